@@ -0,0 +1,669 @@
+/*
+	HandyJson benchmarks, on synthetic corpora generated from a fixed seed: the
+	same scale gives the same bytes on every machine and every run.
+
+		g++ -O2 HandyJson.cpp Benchmark.cpp -o Benchmark
+		./Benchmark [scale] [corpus]
+
+	The scale multiplies the size of every corpus (1 by default, about 4 MB each),
+	the corpus name runs only that one. Every operation runs once per round, the
+	fastest round is reported. Allocations are counted by replacing the global
+	operator new, per document and per round.
+	The KeyPool rows parse every document of a corpus with one HandyJsonKeyPool,
+	whose names live in its own blocks, out of the counts. Their lookups give the
+	pooled names, as a caller holding interned names would; the plain lookups give
+	copies of the names, as a caller passing literals would.
+	On the ndjson corpus, built as C++11, the Fields rows fill one structure per
+	document: from a tree read member by member, then with HandyJsonBind.
+*/
+#include		<stdio.h>
+#include		<stdlib.h>
+#include		<string.h>
+#include		<new>
+#include		<string>
+#include		<vector>
+#include		"HandyJson.h"
+#ifdef HANDYJSON_BINDING
+# include		"HandyJsonBind.h"
+#endif
+
+#if defined(_WIN32)
+# include		<windows.h>
+# include		<psapi.h>
+# ifdef _MSC_VER
+#  pragma comment(lib, "psapi.lib")
+# endif
+#else
+# include		<time.h>
+# include		<sys/resource.h>
+#endif
+
+#define			ROUNDS		5		// Rounds of each operation.
+
+/*
+	+-------------+
+	| Allocations |
+	+-------------+
+					*/
+static size_t	g_allocs = 0;
+static size_t	g_alloc_bytes = 0;
+
+void*			operator new(size_t size)
+{
+	void*		ptr;
+
+	++g_allocs;
+	g_alloc_bytes += size;
+	if (!(ptr = malloc(size ? size : 1)))
+		throw std::bad_alloc();
+	return (ptr);
+}
+
+void*			operator new[](size_t size)
+{
+	return (operator new(size));
+}
+
+void*			operator new(size_t size, const std::nothrow_t&) throw()
+{
+	++g_allocs;
+	g_alloc_bytes += size;
+	return (malloc(size ? size : 1));
+}
+
+void*			operator new[](size_t size, const std::nothrow_t& nt) throw()
+{
+	return (operator new(size, nt));
+}
+
+/* Not inlined: GCC would see free() meet pointers from operator new, and warn */
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void		Release(void* ptr)
+{
+	free(ptr);
+}
+
+void			operator delete(void* ptr) throw()
+{
+	Release(ptr);
+}
+
+void			operator delete[](void* ptr) throw()
+{
+	Release(ptr);
+}
+
+void			operator delete(void* ptr, const std::nothrow_t&) throw()
+{
+	Release(ptr);
+}
+
+void			operator delete[](void* ptr, const std::nothrow_t&) throw()
+{
+	Release(ptr);
+}
+
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+void			operator delete(void* ptr, size_t) throw()		// C++14 sized deallocation, or GCC
+{																// warns (-Wsized-deallocation).
+	Release(ptr);
+}
+
+void			operator delete[](void* ptr, size_t) throw()
+{
+	Release(ptr);
+}
+#endif
+
+/*
+	+-----------------+
+	| Time and memory |
+	+-----------------+
+						*/
+static double	Now()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER	freq, count;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return ((double)count.QuadPart / (double)freq.QuadPart);
+#else
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((double)ts.tv_sec + (double)ts.tv_nsec * 1e-9);
+#endif
+}
+
+/* Peak resident set of the process so far, in MB */
+static double	PeakRss()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS	pmc;
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return (0);
+	return ((double)pmc.PeakWorkingSetSize / (1024.0 * 1024.0));
+#else
+	struct rusage	usage;
+
+	if (getrusage(RUSAGE_SELF, &usage))
+		return (0);
+# if defined(__APPLE__)
+	return ((double)usage.ru_maxrss / (1024.0 * 1024.0));			// Bytes.
+# else
+	return ((double)usage.ru_maxrss / 1024.0);						// Kilobytes.
+# endif
+#endif
+}
+
+/*
+	+---------+
+	| Corpora |
+	+---------+
+				*/
+/* xorshift64*: small, and the same everywhere */
+class			Random
+{
+private:
+	uint64_t		p_state;
+
+public:
+	Random(uint64_t seed) : p_state(seed ? seed : 1) {}
+
+public:
+	uint64_t		Next()
+	{
+		this->p_state ^= this->p_state >> 12;
+		this->p_state ^= this->p_state << 25;
+		this->p_state ^= this->p_state >> 27;
+		return (this->p_state * 2685821657736338717ULL);
+	}
+	size_t			Below(size_t n)		{ return ((size_t)(this->Next() % n)); }
+	double			Unit()				{ return ((double)(this->Next() >> 11) / 9007199254740992.0); }
+	bool			Chance(size_t n)	{ return (!this->Below(n)); }
+};
+
+struct			Corpus
+{
+	const char*					name;
+	std::vector<std::string>	docs;		// One document, or many for NDJSON.
+	size_t						bytes;
+};
+
+static const char*	sg_words[] =
+{
+	"json", "handy", "parse", "tree", "value", "object", "array", "string", "number", "true",
+	"lorem", "ipsum", "dolor", "sit", "amet", "quick", "brown", "fox", "jumps", "over",
+	"lazy", "dog", "river", "stone", "cloud", "north", "light", "paper", "metal", "garden"
+};
+
+static void		AddWords(std::string& out, Random& rng, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i)
+			out += ' ';
+		out += sg_words[rng.Below(sizeof(sg_words) / sizeof(*sg_words))];
+	}
+}
+
+static void		AddInt(std::string& out, int64_t i)
+{
+	char		buf[32];
+
+	sprintf(buf, "%lld", (long long)i);
+	out += buf;
+}
+
+static void		AddUInt(std::string& out, uint64_t u)
+{
+	char		buf[32];
+
+	sprintf(buf, "%llu", (unsigned long long)u);
+	out += buf;
+}
+
+static void		AddDouble(std::string& out, double d, int digits)
+{
+	char		buf[40];
+
+	sprintf(buf, "%.*g", digits, d);
+	out += buf;
+}
+
+/* Status objects of a social network API: many short strings, names and small objects */
+static void		MakeTwitter(Corpus& corpus, Random& rng, size_t size)
+{
+	std::string	out = "{\"statuses\":[";
+
+	for (size_t n = 0; out.size() < size; ++n)
+	{
+		uint64_t	id = 500000000000000000ULL + rng.Next() % 100000000000000000ULL;
+
+		out += n ? ",{" : "{";
+		out += "\"created_at\":\"Mon Sep 24 03:35:21 +0000 2012\",\"id\":";
+		AddUInt(out, id);
+		out += ",\"id_str\":\"";
+		AddUInt(out, id);
+		out += "\",\"text\":\"";
+		AddWords(out, rng, 4 + rng.Below(16));
+		if (rng.Chance(4))
+			out += " \\u3042\\u308a\\u304c\\u3068\\u3046 \\\"quoted\\\"";
+		out += "\",\"truncated\":false,\"user\":{\"id\":";
+		AddUInt(out, rng.Below(1000000000));
+		out += ",\"name\":\"";
+		AddWords(out, rng, 2);
+		out += "\",\"screen_name\":\"";
+		AddWords(out, rng, 1);
+		AddInt(out, (int64_t)rng.Below(10000));
+		out += "\",\"description\":\"";
+		AddWords(out, rng, rng.Below(12));
+		out += "\",\"followers_count\":";
+		AddInt(out, (int64_t)rng.Below(100000));
+		out += ",\"friends_count\":";
+		AddInt(out, (int64_t)rng.Below(5000));
+		out += ",\"verified\":";
+		out += rng.Chance(10) ? "true" : "false";
+		out += ",\"profile_background_color\":\"C0DEED\",\"lang\":\"en\"},\"geo\":null,\"coordinates\":null,";
+		out += "\"entities\":{\"hashtags\":[";
+		for (size_t i = 0, count = rng.Below(4); i < count; ++i)
+		{
+			size_t	at = rng.Below(100);
+
+			out += i ? ",{\"text\":\"" : "{\"text\":\"";
+			AddWords(out, rng, 1);
+			out += "\",\"indices\":[";
+			AddInt(out, (int64_t)at);
+			out += ',';
+			AddInt(out, (int64_t)(at + 8));
+			out += "]}";
+		}
+		out += "],\"urls\":[],\"user_mentions\":[]},\"retweet_count\":";
+		AddInt(out, (int64_t)rng.Below(1000));
+		out += ",\"favorited\":false,\"retweeted\":false,\"lang\":\"en\"}";
+	}
+	out += "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":250126199840518145,\"count\":100}}";
+	corpus.docs.push_back(out);
+}
+
+/* Coordinates and measures: arrays of doubles at full precision, and integers */
+static void		MakeNumbers(Corpus& corpus, Random& rng, size_t size)
+{
+	std::string	out = "{\"type\":\"Polygons\",\"rings\":[";
+
+	for (size_t n = 0; out.size() < size; ++n)
+	{
+		out += n ? ",[" : "[";
+		for (size_t i = 0, count = 16 + rng.Below(64); i < count; ++i)
+		{
+			out += i ? ",[" : "[";
+			AddDouble(out, -180.0 + rng.Unit() * 360.0, 6 + (int)rng.Below(12));
+			out += ',';
+			AddDouble(out, -90.0 + rng.Unit() * 180.0, 6 + (int)rng.Below(12));
+			out += ',';
+			AddInt(out, (int64_t)rng.Below(100000) - 50000);
+			out += ']';
+		}
+		out += ']';
+	}
+	out += "]}";
+	corpus.docs.push_back(out);
+}
+
+/* Objects and arrays nested far below the root, under the default depth limit */
+static void		MakeDeep(Corpus& corpus, Random& rng, size_t size)
+{
+	std::string	out = "[";
+
+	for (size_t n = 0; out.size() < size; ++n)
+	{
+		size_t		depth = 64 + rng.Below(448);
+
+		if (n)
+			out += ',';
+		for (size_t i = 0; i < depth; ++i)
+			out += (i & 1) ? "[" : "{\"k\":";
+		AddInt(out, (int64_t)n);
+		for (size_t i = depth; i--; )
+			out += (i & 1) ? "]" : "}";
+	}
+	out += "]";
+	corpus.docs.push_back(out);
+}
+
+/* Long strings, with escapes and surrogate pairs among the plain text */
+static void		MakeStrings(Corpus& corpus, Random& rng, size_t size)
+{
+	static const char*	escapes[] = { "\\n", "\\t", "\\\"", "\\\\", "\\/", "\\u00e9", "\\u20ac", "\\ud83d\\ude00" };
+	std::string			out = "[";
+
+	for (size_t n = 0; out.size() < size; ++n)
+	{
+		size_t		length = 1024 + rng.Below(15360);
+		size_t		start;
+
+		out += n ? ",\"" : "\"";
+		for (start = out.size(); out.size() - start < length; )
+		{
+			AddWords(out, rng, 1 + rng.Below(8));
+			out += rng.Chance(3) ? escapes[rng.Below(sizeof(escapes) / sizeof(*escapes))] : " ";
+		}
+		out += '\"';
+	}
+	out += "]";
+	corpus.docs.push_back(out);
+}
+
+/* Many small documents, one per line */
+static void		MakeLines(Corpus& corpus, Random& rng, size_t size)
+{
+	for (size_t n = 0, total = 0; total < size; ++n)
+	{
+		std::string	out = "{\"id\":";
+
+		AddInt(out, (int64_t)n);
+		out += ",\"event\":\"";
+		AddWords(out, rng, 1);
+		out += "\",\"ts\":";
+		AddUInt(out, 1700000000000ULL + rng.Below(100000000));
+		out += ",\"score\":";
+		AddDouble(out, rng.Unit() * 100.0, 4);
+		out += ",\"ok\":";
+		out += rng.Chance(2) ? "true" : "false";
+		out += ",\"tags\":[\"";
+		AddWords(out, rng, 1);
+		out += "\",\"";
+		AddWords(out, rng, 1);
+		out += "\"],\"ref\":null}";
+		total += out.size() + 1;
+		corpus.docs.push_back(out);
+	}
+}
+
+/*
+	+------------+
+	| Operations |
+	+------------+
+					*/
+struct			Measure
+{
+	double		seconds;		// Fastest round.
+	size_t		allocs;			// Per round.
+	size_t		alloc_bytes;	//
+	size_t		items;			// Documents, or lookups.
+};
+
+static void		Start(Measure& m, double& t)
+{
+	m.allocs = g_allocs;
+	m.alloc_bytes = g_alloc_bytes;
+	t = Now();
+}
+
+static void		Stop(Measure& m, double t, bool first)
+{
+	t = Now() - t;
+	m.allocs = g_allocs - m.allocs;
+	m.alloc_bytes = g_alloc_bytes - m.alloc_bytes;
+	if (first || t < m.seconds)
+		m.seconds = t;
+}
+
+/* Looks every member of every object up by its name, or by a copy of it, indexing the large ones */
+static size_t	Lookups(HandyJson* item, size_t& found, bool copy)
+{
+	char		name[256];
+	size_t		count = 0;
+
+	for (HandyJson* c = item->GetChild(); c; c = c->GetNext())
+	{
+		if (item->GetType() == json_object && c->GetName() && c->GetNameLen() < sizeof(name))
+		{
+			++count;
+			if (copy)
+				memcpy(name, c->GetName(), c->GetNameLen() + 1);
+			if (item->GetObjectItem(copy ? name : c->GetName()))
+				++found;
+		}
+		if (c->GetChild())
+			count += Lookups(c, found, copy);
+	}
+	return (count);
+}
+
+static void		Report(const Corpus& corpus, const char* op, const Measure& m, bool throughput)
+{
+	size_t		docs = corpus.docs.size();
+
+	if (throughput)
+		printf("%-10s %-16s %10.1f %12.0f", corpus.name, op, (double)corpus.bytes / (1024.0 * 1024.0) / m.seconds, (double)m.items / m.seconds);
+	else
+		printf("%-10s %-16s %10s %12.0f", corpus.name, op, "-", (double)m.items / m.seconds);
+	printf(" %12.1f %12.1f\n", (double)m.allocs / (double)docs, (double)m.alloc_bytes / 1024.0 / (double)docs);
+}
+
+static bool		Run(Corpus& corpus)
+{
+	std::vector<HandyJson*>	roots(corpus.docs.size());
+	std::vector<HandyJson*>	copies(corpus.docs.size());
+	Measure					parse, print, compact, duplicate, lookup, teardown, pooled, pooled_lookup;
+	HandyJsonKeyPool		pool;
+	size_t					found = 0, pooled_found = 0;
+	size_t					output = 0;
+	double					t;
+	char*					str;
+
+	for (size_t round = 0; round < ROUNDS; ++round)
+	{
+		bool	first = !round;
+
+		Start(parse, t);
+		for (size_t i = 0; i < corpus.docs.size(); ++i)
+			if (!(roots[i] = new HandyJson()) || !roots[i]->Parse(corpus.docs[i].c_str()))
+			{
+				printf("%s: document %u does not parse.\n", corpus.name, (unsigned)i);
+				return (false);
+			}
+		Stop(parse, t, first);
+
+		Start(lookup, t);
+		lookup.items = 0;
+		for (size_t i = 0; i < roots.size(); ++i)
+			lookup.items += Lookups(roots[i], found, true);
+		Stop(lookup, t, first);
+
+		Start(print, t);
+		for (size_t i = 0; i < roots.size(); ++i)
+		{
+			str = roots[i]->Print();
+			output += strlen(str);
+			delete[] (str);
+		}
+		Stop(print, t, first);
+
+		Start(compact, t);
+		for (size_t i = 0; i < roots.size(); ++i)
+		{
+			str = roots[i]->PrintUnformated();
+			output += strlen(str);
+			delete[] (str);
+		}
+		Stop(compact, t, first);
+
+		Start(duplicate, t);
+		for (size_t i = 0; i < roots.size(); ++i)
+			copies[i] = roots[i]->Duplicate(true);
+		Stop(duplicate, t, first);
+		for (size_t i = 0; i < copies.size(); ++i)
+			delete (copies[i]);
+
+		Start(teardown, t);
+		for (size_t i = 0; i < roots.size(); ++i)
+			delete (roots[i]);
+		Stop(teardown, t, first);
+
+		pool.Clear();
+		Start(pooled, t);
+		for (size_t i = 0; i < corpus.docs.size(); ++i)
+			if (!(roots[i] = new HandyJson()) || !roots[i]->ParseWithOpts(corpus.docs[i].c_str(), 0, false, 0, &pool))
+			{
+				printf("%s: document %u does not parse.\n", corpus.name, (unsigned)i);
+				return (false);
+			}
+		Stop(pooled, t, first);
+
+		Start(pooled_lookup, t);
+		pooled_lookup.items = 0;
+		for (size_t i = 0; i < roots.size(); ++i)
+			pooled_lookup.items += Lookups(roots[i], pooled_found, false);
+		Stop(pooled_lookup, t, first);
+		for (size_t i = 0; i < roots.size(); ++i)
+			delete (roots[i]);
+	}
+	parse.items = print.items = compact.items = duplicate.items = teardown.items = pooled.items = corpus.docs.size();
+	Report(corpus, "Parse", parse, true);
+	Report(corpus, "Print", print, true);
+	Report(corpus, "PrintUnformated", compact, true);
+	Report(corpus, "Duplicate", duplicate, true);
+	Report(corpus, "GetObjectItem", lookup, false);
+	Report(corpus, "Teardown", teardown, true);
+	Report(corpus, "Parse+KeyPool", pooled, true);
+	Report(corpus, "Lookup+KeyPool", pooled_lookup, false);
+	printf("%-10s %u docs, %.2f MB, %u pooled names, peak RSS %.1f MB%s\n\n", corpus.name, (unsigned)corpus.docs.size(),
+		(double)corpus.bytes / (1024.0 * 1024.0), (unsigned)pool.GetCount(), PeakRss(),
+		found == lookup.items * ROUNDS && pooled_found == pooled_lookup.items * ROUNDS && output ? "" : " (lookups missed)");
+	return (true);
+}
+
+#ifdef HANDYJSON_BINDING
+/* One document of the ndjson corpus */
+struct			Event
+{
+	int64_t						id;
+	std::string					event;
+	uint64_t					ts;
+	double						score;
+	bool						ok;
+	std::vector<std::string>	tags;
+};
+
+HANDYJSON_BIND(Event,
+	HANDYJSON_FIELD(id),
+	HANDYJSON_FIELD(event),
+	HANDYJSON_FIELD(ts),
+	HANDYJSON_FIELD(score),
+	HANDYJSON_FIELD(ok),
+	HANDYJSON_FIELD(tags))
+
+/* The tree is read the usual way, and thrown away */
+static bool		ReadEvent(const char* json, Event& e)
+{
+	HandyJson		root;
+	HandyJson*		tags;
+
+	if (!root.Parse(json))
+		return (false);
+	e.id = root.GetObjectItem("id")->GetValInt64();
+	e.event = root.GetObjectItem("event")->GetValStr();
+	e.ts = root.GetObjectItem("ts")->GetValUInt64();
+	e.score = root.GetObjectItem("score")->GetValDbl();
+	e.ok = root.GetObjectItem("ok")->GetType() == json_true;
+	tags = root.GetObjectItem("tags");
+	e.tags.clear();
+	for (HandyJson* c = tags->GetChild(); c; c = c->GetNext())
+		e.tags.push_back(c->GetValStr());
+	return (true);
+}
+
+static bool		RunFields(Corpus& corpus)
+{
+	Measure			tree, bound;
+	Event			a, b;
+	uint64_t		check_tree = 0, check_bound = 0;
+	double			t;
+
+	for (size_t round = 0; round < ROUNDS; ++round)
+	{
+		bool	first = !round;
+
+		Start(tree, t);
+		for (size_t i = 0; i < corpus.docs.size(); ++i)
+		{
+			if (!ReadEvent(corpus.docs[i].c_str(), a))
+				return (false);
+			check_tree += a.id + a.ts + a.tags.size() + a.event.size() + a.ok;
+		}
+		Stop(tree, t, first);
+
+		Start(bound, t);
+		for (size_t i = 0; i < corpus.docs.size(); ++i)
+		{
+			if (!HandyJsonBind::Read(corpus.docs[i].c_str(), b))
+				return (false);
+			check_bound += b.id + b.ts + b.tags.size() + b.event.size() + b.ok;
+		}
+		Stop(bound, t, first);
+	}
+	tree.items = bound.items = corpus.docs.size();
+	Report(corpus, "Fields+Tree", tree, true);
+	Report(corpus, "Fields+Bind", bound, true);
+	if (check_tree != check_bound)
+		printf("%-10s the structures differ\n", corpus.name);
+	printf("\n");
+	return (check_tree == check_bound);
+}
+#endif
+
+/*
+	+------+
+	| Main |
+	+------+
+			*/
+int				main(int argc, char** argv)
+{
+	static const struct
+	{
+		const char*		name;
+		void			(*make)(Corpus&, Random&, size_t);
+	}				shapes[] =
+	{
+		{ "twitter", MakeTwitter },
+		{ "numbers", MakeNumbers },
+		{ "deep", MakeDeep },
+		{ "strings", MakeStrings },
+		{ "ndjson", MakeLines }
+	};
+	double			scale = argc > 1 ? atof(argv[1]) : 1.0;
+	const char*		only = argc > 2 ? argv[2] : 0;
+	bool			ok = true;
+
+	if (scale <= 0)
+	{
+		printf("Usage: %s [scale] [twitter|numbers|deep|strings|ndjson]\n", argv[0]);
+		return (1);
+	}
+	printf("%-10s %-16s %10s %12s %12s %12s\n", "corpus", "operation", "MB/s", "items/s", "allocs/doc", "KB/doc");
+	for (size_t i = 0; i < sizeof(shapes) / sizeof(*shapes); ++i)
+	{
+		Corpus		corpus;
+		Random		rng(0x48616e64794a736fULL + i);						// Same seed, same bytes.
+
+		if (only && strcmp(only, shapes[i].name))
+			continue;
+		corpus.name = shapes[i].name;
+		shapes[i].make(corpus, rng, (size_t)(scale * 4.0 * 1024.0 * 1024.0));
+		corpus.bytes = 0;
+		for (size_t d = 0; d < corpus.docs.size(); ++d)
+			corpus.bytes += corpus.docs[d].size();
+		ok = Run(corpus) && ok;
+#ifdef HANDYJSON_BINDING
+		if (shapes[i].make == MakeLines)
+			ok = RunFields(corpus) && ok;
+#endif
+	}
+	return (ok ? 0 : 1);
+}
@@ -29,7 +29,79 @@
 
 #include				"HandyJson.h"
 
-const char*				HandyJson::sp_err = 0x0;
+/*
+	SIMD scanning kernels. SSE2 is part of every x86-64 CPU, AVX2 is only used
+	when the running CPU supports it. Define HANDYJSON_NO_SIMD to only keep the
+	scalar kernels.
+*/
+#if !defined(HANDYJSON_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+# define	HANDYJSON_SSE2
+# include	<emmintrin.h>
+# if defined(_MSC_VER) || ((defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)))
+#  define	HANDYJSON_AVX2
+#  include	<immintrin.h>
+# endif
+#endif
+#if defined(_MSC_VER)
+# include	<intrin.h>
+#endif
+#include	<locale.h>
+#include	<ostream>
+
+#if defined(_WIN32)
+# ifndef WIN32_LEAN_AND_MEAN
+#  define	WIN32_LEAN_AND_MEAN
+# endif
+# ifndef NOMINMAX
+#  define	NOMINMAX
+# endif
+# include	<windows.h>
+# include	<io.h>
+#elif defined(__unix__) || defined(__APPLE__)
+# define	HANDYJSON_MMAP
+# include	<fcntl.h>
+# include	<unistd.h>
+# include	<sys/mman.h>
+# include	<sys/stat.h>
+# include	<errno.h>
+# if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define	MAP_ANONYMOUS	MAP_ANON
+# endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+# define	HANDYJSON_AVX2_TARGET	__attribute__((target("avx2")))
+# define	HANDYJSON_NO_SANITIZE	__attribute__((no_sanitize_address))	// Aligned loads may read past the end of data, never past its page.
+#else
+# define	HANDYJSON_AVX2_TARGET
+# define	HANDYJSON_NO_SANITIZE
+#endif
+
+#ifdef HANDYJSON_THREADS
+# include	<thread>
+# include	<mutex>
+# include	<condition_variable>
+# include	<vector>
+#endif
+
+#include				"HandyJsonTables.h"
+
+#ifndef HANDYJSON_MAX_DEPTH
+# define	HANDYJSON_MAX_DEPTH		1024	// Default nesting limit of the parsers, see SetMaxDepth().
+#endif
+#ifndef HANDYJSON_WRITE_BUFFER
+# define	HANDYJSON_WRITE_BUFFER	16384	// Default buffer of a HandyJsonWriter.
+#endif
+#ifndef HANDYJSON_INDEX_MIN
+# define	HANDYJSON_INDEX_MIN		16		// Children walked by a GetObjectItem() before the object gets indexed.
+#endif
+
+HANDYJSON_THREAD_LOCAL const char*	HandyJson::sp_err = 0x0;
+size_t					HandyJson::sp_max_depth = HANDYJSON_MAX_DEPTH;
+
+const char*				(*HandyJson::sp_skip)(const char*) = HandyJson::SkipScalar;				// Constant initialization,
+const char*				(*HandyJson::sp_scan_str)(const char*) = HandyJson::ScanStringScalar;	// valid before the one below.
+const bool				HandyJson::sp_kernels = HandyJson::SelectKernels();
 
 const unsigned char		HandyJson::sp_firstByteMark[7] = {
 	0x00,
@@ -41,37 +113,270 @@ const unsigned char		HandyJson::sp_firstByteMark[7] = {
 	0xFC
 };
 
+/*
+	Growable output buffer used by the printing functions. The whole tree is
+	written once into it, with no intermediate string per item.
+*/
+struct			HandyJson::PrintBuffer
+{
+	char*		buf;
+	size_t		len;
+	size_t		cap;
+
+	bool		Init(size_t size)
+	{
+		this->len = 0;
+		this->cap = size;
+		this->buf = new char[size];
+		return (this->buf != 0);
+	}
+
+	bool		Reserve(size_t n)
+	{
+		char*		nbuf;
+		size_t		ncap = this->cap;
+
+		if (this->len + n <= this->cap)
+			return (true);
+		while (ncap < this->len + n)
+			ncap *= 2;
+		if (!(nbuf = new char[ncap]))
+			return (false);
+		memcpy(nbuf, this->buf, this->len);
+		delete[] (this->buf);
+		this->buf = nbuf;
+		this->cap = ncap;
+		return (true);
+	}
+
+	bool		Put(char c)
+	{
+		if (!this->Reserve(1))
+			return (false);
+		this->buf[this->len++] = c;
+		return (true);
+	}
+
+	bool		Put(const char* s, size_t n)
+	{
+		if (!this->Reserve(n))
+			return (false);
+		memcpy(this->buf + this->len, s, n);
+		this->len += n;
+		return (true);
+	}
+
+	bool		PutTabs(int n)
+	{
+		if (n <= 0)
+			return (true);
+		if (!this->Reserve(n))
+			return (false);
+		memset(this->buf + this->len, '\t', n);
+		this->len += n;
+		return (true);
+	}
+
+	/* A lead byte, then v on n bytes in network order */
+	bool		PutBigEndian(unsigned char lead, uint64_t v, int n)
+	{
+		if (!this->Reserve(n + 1))
+			return (false);
+		this->buf[this->len++] = (char)lead;
+		while (n-- > 0)
+			this->buf[this->len++] = (char)(v >> (n * 8));
+		return (true);
+	}
+
+	/* MessagePack head of a string, an array or a map */
+	bool		PutMsgPackHead(eTypes type, size_t n)
+	{
+		unsigned char	fix = type == json_string ? 0xa0 : type == json_array ? 0x90 : 0x80;
+
+		if (n < (type == json_string ? 32u : 16u))
+			return (this->PutBigEndian(fix | (unsigned char)n, 0, 0));
+		if (n <= 0xff && type == json_string)
+			return (this->PutBigEndian(0xd9, n, 1));
+		if (n <= 0xffff)
+			return (this->PutBigEndian(type == json_string ? 0xda : type == json_array ? 0xdc : 0xde, n, 2));
+		return (this->PutBigEndian(type == json_string ? 0xdb : type == json_array ? 0xdd : 0xdf, n, 4));
+	}
+
+	/* CBOR head: the major type and its argument, in the fewest bytes */
+	bool		PutCborHead(unsigned char major, uint64_t v)
+	{
+		major <<= 5;
+		if (v < 24)
+			return (this->PutBigEndian(major | (unsigned char)v, 0, 0));
+		if (v <= 0xff)
+			return (this->PutBigEndian(major | 24, v, 1));
+		if (v <= 0xffff)
+			return (this->PutBigEndian(major | 25, v, 2));
+		if (v <= 0xffffffff)
+			return (this->PutBigEndian(major | 26, v, 4));
+		return (this->PutBigEndian(major | 27, v, 8));
+	}
+};
+
+/* An empty object: no name, no children, and a zero value whatever the type */
 HandyJson::HandyJson(void) :
-	p_name(0), p_next(0), p_prev(0), p_child(0), p_value_as_str(0), p_value_as_int(0), p_value_as_dbl(0)
+	p_next(0), p_prev(0), p_arena(0), p_size(0), p_type(json_object), p_flags(0)
 {
-	this->BuildInObject();
+	memset(&this->p_name, 0, sizeof(Str));
+	memset(&this->p_value, 0, sizeof(Value));
 }
 
 HandyJson::HandyJson(eTypes t) :
-	p_name(0), p_next(0), p_prev(0), p_child(0), p_value_as_str(0), p_value_as_int(0), p_value_as_dbl(0)
+	p_next(0), p_prev(0), p_arena(0), p_size(0), p_type(t), p_flags(0)
 {
-	this->p_type = t;
+	memset(&this->p_name, 0, sizeof(Str));
+	memset(&this->p_value, 0, sizeof(Value));
 }
 
-HandyJson::HandyJson(const HandyJson& hj)
+HandyJson::HandyJson(HandyJsonArena* arena) :
+	p_next(0), p_prev(0), p_arena(arena), p_size(0), p_type(json_object), p_flags(0)
 {
-	this->p_type = hj.GetType();
-	this->p_name = hj.StrDup(hj.GetName());
-	this->p_next = hj.GetNext();
-	this->p_prev = hj.GetPrev();
-	this->p_child = hj.GetChild();
-	this->p_value_as_str = hj.StrDup(hj.GetValStr());
-	this->p_value_as_int = hj.GetValInt();
-	this->p_value_as_dbl = hj.GetValDbl();
+	memset(&this->p_name, 0, sizeof(Str));
+	memset(&this->p_value, 0, sizeof(Value));
 }
 
+HandyJson::HandyJson(const HandyJson& hj) :
+	p_next(0), p_prev(0), p_arena(0), p_size(0), p_type(json_null), p_flags(0)
+{
+	memset(&this->p_name, 0, sizeof(Str));
+	memset(&this->p_value, 0, sizeof(Value));
+	if (hj.GetName())
+		this->StoreStr(this->p_name, flag_name_in, hj.GetName(), hj.GetNameLen());
+	this->CopyFrom(hj, true);
+}
+
+#ifdef HANDYJSON_MOVE
+HandyJson::HandyJson(HandyJson&& hj) noexcept :
+	p_next(0), p_prev(0), p_arena(hj.p_arena), p_size(0), p_type(json_null), p_flags(0)
+{
+	memset(&this->p_name, 0, sizeof(Str));
+	memset(&this->p_value, 0, sizeof(Value));
+	if (hj.GetName())
+		this->StoreStr(this->p_name, flag_name_in, hj.GetName(), hj.GetNameLen());	// The original may stay in an object, it keeps its name.
+	this->TakeFrom(hj);
+}
+#endif
+
+/*
+	Deleting an item deletes its children and its following siblings. They are
+	walked as one list, without recursion: before a node is deleted alone, its
+	children are spliced in front of the rest of the list.
+*/
 HandyJson::~HandyJson(void)
 {
-	if (this->p_child) delete (this->p_child);	// Think about setting null pointers.
-	if (this->p_value_as_str) delete (this->p_value_as_str);
-	if (this->GetName()) delete (this->p_name);
-	if (this->GetNext())
-		delete (this->GetNext());
+	HandyJson*	list;
+	HandyJson*	n;
+	HandyJson*	c;
+
+	if (this->p_arena)
+		return;		// Children and strings are released with the arena.
+	this->IndexDrop();
+	this->ItemsDrop();
+	this->FreeValStr();
+	this->FreeName();
+	list = this->p_next;
+	if ((c = this->GetChild()))
+	{
+		c->p_prev->p_next = list;		// The last child.
+		list = c;
+	}
+	while (list)
+	{
+		n = list;
+		list = n->p_next;
+		if ((c = n->GetChild()))
+		{
+			c->p_prev->p_next = list;
+			list = c;
+			n->p_value.kids.first = 0;
+		}
+		n->p_next = 0;
+		delete (n);
+	}
+}
+
+/* The copy is built aside, so that the source may be one of the children */
+HandyJson&		HandyJson::operator=(const HandyJson& hj)
+{
+	HandyJson	copy(this->p_arena);
+
+	if (this != &hj && copy.CopyFrom(hj, true))
+	{
+		this->ClearValue();
+		this->TakeFrom(copy);
+	}
+	return (*this);
+}
+
+#ifdef HANDYJSON_MOVE
+HandyJson&		HandyJson::operator=(HandyJson&& hj)
+{
+	HandyJson	value(json_null);
+
+	if (this == &hj)
+		return (*this);
+	if (this->p_arena != hj.p_arena)
+		return (*this = static_cast<const HandyJson&>(hj));
+	value.p_arena = hj.p_arena;
+	value.TakeFrom(hj);
+	this->ClearValue();
+	this->TakeFrom(value);
+	return (*this);
+}
+#endif
+
+/* Basics getters */
+int64_t			HandyJson::GetValInt64() const
+{
+	double		d = this->p_value.d;
+
+	if (this->p_type > json_number)
+		return (0);
+	if (this->p_type != json_number)
+		return (this->p_value.i);
+	if (this->p_flags & flag_uint)		// Above INT64_MAX, saturates as a double.
+		return (INT64_MAX);
+	if (this->p_flags & flag_int)
+		return (this->p_value.i);
+	if (d >= 9223372036854775807.0)
+		return (INT64_MAX);
+	if (d <= -9223372036854775808.0)
+		return (INT64_MIN);
+	return (d == d ? (int64_t)d : 0);
+}
+
+/* Saturates to [0, UINT64_MAX] */
+uint64_t		HandyJson::GetValUInt64() const
+{
+	double		d = this->p_value.d;
+
+	if (this->p_type > json_number)
+		return (0);
+	if (this->p_type != json_number)
+		return ((uint64_t)this->p_value.i);
+	if (this->p_flags & flag_uint)
+		return ((uint64_t)this->p_value.i);
+	if (this->p_flags & flag_int)
+		return (this->p_value.i < 0 ? 0 : (uint64_t)this->p_value.i);
+	if (d >= 18446744073709551615.0)
+		return (UINT64_MAX);
+	return (d > 0 ? (uint64_t)d : 0);		// NaN included.
+}
+
+double			HandyJson::GetValDbl() const
+{
+	if (this->p_type != json_number)
+		return (0);
+	if (!(this->p_flags & flag_int))
+		return (this->p_value.d);
+	if (this->p_flags & flag_uint)
+		return ((double)(uint64_t)this->p_value.i);
+	return ((double)this->p_value.i);
 }
 
 /* Basics setters */
@@ -80,12 +385,7 @@ bool			HandyJson::SetName(const char* n)
 	if (!n)
 		return (false);
 	if (this->GetName())
-	{
-		delete (this->p_name);
-		this->p_name = this->StrDup(n);
-		if (this->p_name)
-			return (true);
-	}
+		return (this->AssignName(n));
 	return (false);
 }
 
@@ -94,45 +394,74 @@ bool			HandyJson::SetValStr(const char* s)
 	if (!s)
 		return (false);
 	if (this->GetValStr())
-	{
-		delete (this->GetValStr());
-		this->p_value_as_str = this->StrDup(s);
-		if (this->p_value_as_str)
-			return (true);
-	}
+		return (this->AssignValStr(s));
 	return (false);
 }
 
 bool			HandyJson::SetValInt(int i)
 {
-	this->p_value_as_int = i;
+	return (this->SetValInt64(i));
+}
+
+bool			HandyJson::SetValInt64(int64_t i)
+{
+	NumberValue	n;
+
+	if (this->p_type != json_number)
+		return (false);
+	n.bits = (uint64_t)i;
+	n.dbl = (double)i;
+	n.is_int = true;
+	n.is_uint = false;
+	this->SetNumber(n);
+	return (true);
+}
+
+bool			HandyJson::SetValUInt64(uint64_t u)
+{
+	NumberValue	n;
+
+	if (this->p_type != json_number)
+		return (false);
+	n.bits = u;
+	n.dbl = (double)u;
+	n.is_int = true;
+	n.is_uint = u > (uint64_t)INT64_MAX;
+	this->SetNumber(n);
 	return (true);
 }
 
 bool			HandyJson::SetValDbl(double d)
 {
-	this->p_value_as_dbl = d;
+	NumberValue	n;
+
+	if (this->p_type != json_number)
+		return (false);
+	n.dbl = d;
+	n.is_int = false;
+	this->SetNumber(n);
 	return (true);
 }
 
 /* Main functions */
 int				HandyJson::GetArraySize() const
 {
-	HandyJson *c = this->GetChild();;
-	
-	int i = 0;
-	while (c)
-	{
-		i++;
-		c = c->GetNext();
-	}
-	return (i);
+	return ((int)this->p_size);
 }
 
+/* Only reads the table: threads may share a const tree */
 HandyJson*		HandyJson::GetArrayItem(int item) const
 {
-	HandyJson *c = this->GetChild();
-	
+	ItemIndex*	idx;
+	HandyJson*	c;
+
+	if (item <= 0)
+		return (this->GetChild());
+	if ((unsigned int)item >= this->p_size)
+		return (0);
+	if ((idx = this->Items()))
+		return (idx->items[item]);
+	c = this->GetChild();
 	while (c && item > 0)
 	{
 		c = c->GetNext();
@@ -141,31 +470,41 @@ HandyJson*		HandyJson::GetArrayItem(int item) const
 	return (c);
 }
 
+/* Same, building the table for a child past the first ones */
+HandyJson*		HandyJson::GetArrayItem(int item)
+{
+	if (item >= HANDYJSON_INDEX_MIN && (unsigned int)item < this->p_size && !this->Items())
+		this->ItemsBuild();
+	return (static_cast<const HandyJson*>(this)->GetArrayItem(item));
+}
+
+/* Only reads the index: threads may share a const tree */
 HandyJson*		HandyJson::GetObjectItem(const char* string) const
 {
-	HandyJson* c = this->GetChild();
-	
-	while (c && this->StrCaseCmp(c->GetName(), string))
-		c = c->GetNext();
+	int			walked;
+
+	return (this->WalkItem(string, walked));
+}
+
+/* Same, indexing the object after a slow lookup */
+HandyJson*		HandyJson::GetObjectItem(const char* string)
+{
+	HandyJson*	c;
+	int			walked;
+
+	c = this->WalkItem(string, walked);
+	if (walked >= HANDYJSON_INDEX_MIN && string && this->GetType() == json_object)
+		this->IndexBuild();
 	return (c);
 }
 
 bool			HandyJson::AddItemToArray(HandyJson* item)
 {
-	HandyJson* c = this->GetChild();
-
     if (this->GetType() != json_array)
 		return (false);
-	if (!item)
+	if (!item || item->GetArena() != this->GetArena())
 		return (false);
-	if (!c)
-		this->p_child = item;
-	else
-	{
-		while (c && c->GetNext())
-			c = c->GetNext(); 
-		c->SuffixItem(item);
-	}
+	this->AppendChild(item);
 	return (true);
 }
 
@@ -173,183 +512,132 @@ bool			HandyJson::AddItemToObject(const char* string, HandyJson* item)
 {
     if (this->GetType() != json_object)
 		return (false);
-	if (!item)
+	if (!item || item->GetArena() != this->GetArena())
 		return (false); 
-	if (item->GetName())
-		delete (item->GetName());
-	item->p_name = this->StrDup(string);
-	
-	HandyJson* c = this->GetChild();
-
-	if (!item)
-		return (false);
-	if (!c)
-		this->p_child = item;
-	else
-	{
-		while (c && c->GetNext())
-			c = c->GetNext(); 
-		c->SuffixItem(item);
-	}
+	item->AssignName(string);
+	this->AppendChild(item);
 	return (true);
 }
 
 HandyJson*		HandyJson::DetachItemFromArray(int which)
 {
-	HandyJson* c = this->GetChild();
-	
-	while (c && which > 0)
-	{
-		c = c->GetNext();
-		--which;
-	}
+	HandyJson* c = this->GetArrayItem(which);
+
 	if (!c) return (0);
-	if (c->GetPrev()) c->p_prev->p_next = c->GetNext();
-	if (c->GetNext()) c->p_next->p_prev = c->GetPrev();
-	if (c == this->p_child) this->p_child = c->p_next;
-	c->p_prev = c->p_next = 0;
-	return (c);
+	return (this->DetachItem(c, which > 0 ? which : 0));
 }
 
 void			HandyJson::DeleteItemFromArray(int which)
 {
-	delete (this->DetachItemFromArray(which));
+	HandyJson*	c = this->DetachItemFromArray(which);
+
+	if (c && !c->GetArena())
+		delete (c);
 }
 
 HandyJson*		HandyJson::DetachItemFromObject(const char* string)
 {
-	int i = 0;
-	HandyJson* c = this->GetChild();
-	while (c && this->StrCaseCmp(c->GetName(), string)) i++, c = c->p_next;
+	HandyJson* c = this->GetObjectItem(string);
+
 	if (c)
-		return (this->DetachItemFromArray(i));
+		return (this->DetachItem(c, -1));
 	return 0;
 }
 
 void			HandyJson::DeleteItemFromObject(const char* string)
 {
-	delete (this->DetachItemFromObject(string));
+	HandyJson*	c = this->DetachItemFromObject(string);
+
+	if (c && !c->GetArena())
+		delete (c);
 }
 
 void			HandyJson::ReplaceItemInArray(int which, HandyJson* newitem)
 {
-	HandyJson* c = this->GetChild();
+	HandyJson* c = this->GetArrayItem(which);
 
-	while (c && which > 0)
-	{
-		c = c->GetNext();
-		--which;
-	}
-	if (!c)
+	if (!c || newitem->GetArena() != this->GetArena())
 		return;
-	newitem->p_next = c->GetNext();
-	newitem->p_prev = c->GetPrev();
-	if (newitem->GetNext()) newitem->p_next->p_prev = newitem;
-	if (c == this->GetChild())
-		this->p_child = newitem;
-	else
-		newitem->p_prev->p_next = newitem;
-	c->p_next = 0;
-	c->p_prev = 0;
-	delete (c);
+	this->ReplaceItem(c, newitem, which > 0 ? which : 0);
 }
 
 void			HandyJson::ReplaceItemInObject(const char* string, HandyJson* newitem)
 {
-	HandyJson* c = this->GetChild();
-	int i = 0;
+	HandyJson* c = this->GetObjectItem(string);
 
-	while (c && this->StrCaseCmp(c->GetName(), string))
-	{
-		c = c->GetNext();
-		++i;
-	}
-	if (c)
+	if (c && newitem->GetArena() == this->GetArena())
 	{
-		newitem->p_name = this->StrDup(string);
-		this->ReplaceItemInArray(i, newitem);
+		newitem->AssignName(string);
+		this->ReplaceItem(c, newitem, -1);
 	}
 }
 
 HandyJson*		HandyJson::Duplicate(bool recurse)
 {
-	HandyJson *newitem, *cptr, *nptr = 0, *newchild;
+	HandyJson*	newitem;
 
-	newitem = new HandyJson();
-	if (!newitem)
+	if (!(newitem = new HandyJson()))
 		return (0);
-	newitem->p_type = this->GetType();
-	newitem->p_value_as_int = this->GetValInt();
-	newitem->p_value_as_dbl = this->GetValDbl();
-	if (this->GetValStr())
-	{
-		newitem->p_value_as_str = this->StrDup(this->GetValStr());
-		if (!newitem->GetValStr())
-		{
-			delete (newitem);
-			return (0);
-		}
-	}
-	if (this->GetName())
+	if ((this->GetName() && !newitem->StoreStr(newitem->p_name, flag_name_in, this->GetName(), this->GetNameLen())) ||
+		!newitem->CopyFrom(*this, recurse))
 	{
-		newitem->p_name = this->StrDup(this->GetName());
-		if (!newitem->GetName())
-		{
-			delete (newitem);
-			return (0);
-		}
+		delete (newitem);
+		return (0);
 	}
+	return (newitem);
+}
 
-	if (recurse == false)
-		return (newitem);
+bool			HandyJson::ParseWithOpts(const char* value, const char** return_parse_end, bool require_null_terminated, HandyJsonError* error, HandyJsonKeyPool* keys)
+{
+	ParseContext	ctx;
 
-	cptr = this->GetChild();
-	while (cptr)
-	{
-		newchild = cptr->Duplicate(true);
-		if (!newchild)
-		{
-			delete (newitem);
-			return (0);
-		}
-		if (nptr)
-		{
-			nptr->p_next = newchild;
-			newchild->p_prev = nptr;
-			nptr = newchild;
-		}
-		else
-		{
-			newitem->p_child = newchild;
-			nptr = newchild;
-		}
-		cptr = cptr->GetNext();
-	}
-	return (newitem);
+	ctx.in_situ = false;
+	ctx.keys = keys;
+	return (this->ParseRoot(value, return_parse_end, require_null_terminated, ctx, error));
+}
+
+bool			HandyJson::ParseInSituWithOpts(char* buffer, char** return_parse_end, bool require_null_terminated, HandyJsonError* error, HandyJsonKeyPool* keys)
+{
+	ParseContext	ctx;
+
+	ctx.in_situ = true;
+	ctx.keys = keys;
+	return (this->ParseRoot(buffer, (const char**)return_parse_end, require_null_terminated, ctx, error));
 }
 
-bool			HandyJson::ParseWithOpts(const char* value, const char** return_parse_end, bool require_null_terminated)
+bool			HandyJson::ParseRoot(const char* value, const char** return_parse_end, bool require_null_terminated, ParseContext& ctx, HandyJsonError* error)
 {
 	const char* end = 0;
 	
-	HandyJson::sp_err = 0;
+	ctx.start = value;
+	ctx.where = 0;
+	ctx.code = json_error_none;
+	ctx.stack = 0;
+	ctx.stack_size = 0;
+	ctx.max_depth = HandyJson::sp_max_depth;
 
-	end = this->ParseValue(this->Skip(value));
-	if (!end)
-		return (false);
+	this->ClearValue();		// The parse functions fill empty items only.
+	end = this->ParseValue(this->Skip(value), ctx);
+	delete[] (ctx.stack);
+	return (HandyJson::Finish(ctx, end, return_parse_end, require_null_terminated, error));
+}
+
+bool			HandyJson::ParseFile(const char* path, HandyJsonError* error)
+{
+	HandyJsonFile	file;
 
-	if (require_null_terminated == true) 
+	if (!file.Open(path))
 	{
-		end = this->Skip(end);
-		if (*end)
+		HandyJson::sp_err = 0;
+		if (error)
 		{
-			HandyJson::sp_err = end;
-			return (false);
+			error->code = json_error_file;
+			error->offset = 0;
+			error->line = error->column = 0;
 		}
+		return (false);
 	}
-	if (return_parse_end)
-		*return_parse_end = end;
-	return (true);
+	return (this->ParseWithOpts(file.GetData(), 0, false, error));
 }
 
 bool			HandyJson::Parse(const char* value)
@@ -357,53 +645,189 @@ bool			HandyJson::Parse(const char* value)
 	return (this->ParseWithOpts(value, 0, false));
 }
 
+bool			HandyJson::ParseInSitu(char* buffer)
+{
+	return (this->ParseInSituWithOpts(buffer, 0, false));
+}
+
 char*			HandyJson::Print()
 {
-	return (this->PrintValue(0, 1));
+	return (this->PrintToString(1));
 }
 
 char*			HandyJson::PrintUnformated()
 {
-	return (this->PrintValue(0, 0));
+	return (this->PrintToString(0));
+}
+
+bool			HandyJson::Print(HandyJsonSink& sink) const
+{
+	HandyJsonWriter	writer(sink, true);
+
+	return (this->Fire(writer) && writer.Flush());
+}
+
+bool			HandyJson::PrintUnformated(HandyJsonSink& sink) const
+{
+	HandyJsonWriter	writer(sink, false);
+
+	return (this->Fire(writer) && writer.Flush());
+}
+
+/* Same walk as the HandyJson destructor: down to the children, then along the siblings and up */
+bool			HandyJson::Fire(HandyJsonHandler& handler) const
+{
+	const HandyJson*	item = this;
+	const HandyJson**	parents = 0;
+	const HandyJson**	p;
+	size_t				depth = 0, size = 0;
+	bool				ok = true;
+
+	for (;;)
+	{
+		if (depth && parents[depth - 1]->GetType() == json_object &&
+			!(ok = handler.Key(item->GetName() ? item->GetName() : "", item->GetNameLen())))
+			break;
+		switch (item->GetType())
+		{
+			case json_false:	ok = handler.Bool(false);	break;
+			case json_true:		ok = handler.Bool(true);	break;
+			case json_null:		ok = handler.Null();		break;
+			case json_string:	ok = handler.String(item->GetValStr() ? item->GetValStr() : "", item->GetValStrLen());	break;
+			case json_number:
+				if (item->p_flags & flag_uint)
+					ok = handler.UInt64((uint64_t)item->p_value.i);
+				else if (item->p_flags & flag_int)
+					ok = handler.Int64(item->p_value.i);
+				else
+					ok = handler.Number(item->p_value.d);
+				break;
+			default:
+				ok = item->GetType() == json_array ? handler.StartArray() : handler.StartObject();
+				if (ok && item->GetChild())
+				{
+					if (depth == size)
+					{
+						size = size ? size * 2 : 32;
+						if (!(p = new const HandyJson*[size]))
+						{
+							ok = false;
+							break;
+						}
+						if (depth)
+							memcpy(p, parents, depth * sizeof(HandyJson*));
+						delete[] (parents);
+						parents = p;
+					}
+					parents[depth++] = item;
+					item = item->GetChild();
+					continue;
+				}
+				ok = ok && (item->GetType() == json_array ? handler.EndArray() : handler.EndObject());
+				break;
+		}
+
+		/* Close the containers ending here, until one has a next child */
+		while (ok && depth && !item->GetNext())
+		{
+			item = parents[--depth];
+			ok = item->GetType() == json_array ? handler.EndArray() : handler.EndObject();
+		}
+		if (!ok || !depth)
+			break;
+		item = item->GetNext();
+	}
+	delete[] (parents);
+	return (ok);
+}
+
+char*			HandyJson::PrintToString(int fmt) const
+{
+	PrintBuffer	pb;
+
+	if (!pb.Init(256))
+		return (0);
+	if (!this->PrintValue(pb, 0, fmt) || !pb.Put('\0'))
+	{
+		delete[] (pb.buf);
+		return (0);
+	}
+	return (pb.buf);
+}
+
+bool			HandyJson::ParseSax(const char* value, HandyJsonHandler& handler)
+{
+	return (HandyJson::ParseSaxWithOpts(value, handler, 0, false));
+}
+
+bool			HandyJson::ParseSaxWithOpts(const char* value, HandyJsonHandler& handler, const char** return_parse_end, bool require_null_terminated, HandyJsonError* error)
+{
+	SaxContext	ctx;
+	const char*	end;
+
+	ctx.start = value;
+	ctx.where = 0;
+	ctx.code = json_error_none;
+	ctx.handler = &handler;
+	ctx.scratch = 0;
+	ctx.size = 0;
+	ctx.stack = 0;
+	ctx.stack_size = 0;
+	ctx.max_depth = HandyJson::sp_max_depth;
+	end = HandyJson::SaxValue(HandyJson::Skip(value), ctx);
+	delete[] (ctx.scratch);
+	delete[] (ctx.stack);
+	return (HandyJson::Finish(ctx, end, return_parse_end, require_null_terminated, error));
 }
 
 /* Types functions */
 void			HandyJson::BuildInNull()
 {
-    this->p_type = json_null;
+	this->SetType(json_null);
 }
 
 void			HandyJson::BuildInTrue()
 {
-    this->p_type = json_true;
+	this->SetType(json_true);
 }
 
 void			HandyJson::BuildInFalse()
 {
-    this->p_type = json_false;
+	this->SetType(json_false);
 }
 
 void			HandyJson::BuildInNumber(double number)
 {
-    this->p_type = json_number;
-	this->p_value_as_dbl = number;
-	this->p_value_as_int = (int)number;
+	this->SetType(json_number);
+	this->SetValDbl(number);
+}
+
+void			HandyJson::BuildInInt64(int64_t number)
+{
+	this->SetType(json_number);
+	this->SetValInt64(number);
+}
+
+void			HandyJson::BuildInUInt64(uint64_t number)
+{
+	this->SetType(json_number);
+	this->SetValUInt64(number);
 }
 
 void			HandyJson::BuildInString(const char* string)
 {
-    this->p_type = json_string;
-	this->p_value_as_str = this->StrDup(string);
+	this->SetType(json_string);
+	this->AssignValStr(string);
 }
 
 void			HandyJson::BuildInArray()
 {
-    this->p_type = json_array;
+	this->SetType(json_array);
 }
 
 void			HandyJson::BuildInObject()
 {
-    this->p_type = json_object;
+	this->SetType(json_object);
 }
 
 /* Arrays building functions */
@@ -412,19 +836,14 @@ void			HandyJson::BuildInIntArray(const int* numbers, int count)
 	int			i;
 
 	HandyJson* n = 0;
-	HandyJson* p = 0;
 	this->BuildInArray();
 	for (i = 0; i < count; ++i)
 	{
-		n = new HandyJson();
+		n = this->NewItem();
 		if (!n)
 			return ;
-		n->BuildInNumber(numbers[i]);
-		if (!i)
-			this->p_child = n;
-		else
-			p->SuffixItem(n);
-		p = n;
+		n->BuildInInt64(numbers[i]);
+		this->AppendChild(n);
 	}
 }
 
@@ -433,19 +852,14 @@ void			HandyJson::BuildInFltArray(const float* numbers, int count)
 	int			i;
 
 	HandyJson* n = 0;
-	HandyJson* p = 0;
 	this->BuildInArray();
 	for (i = 0; i < count; ++i)
 	{
-		n = new HandyJson();
+		n = this->NewItem();
 		if (!n)
 			return ;
 		n->BuildInNumber(numbers[i]);
-		if (!i)
-			this->p_child = n;
-		else
-			p->SuffixItem(n);
-		p = n;
+		this->AppendChild(n);
 	}
 }
 
@@ -454,19 +868,14 @@ void			HandyJson::BuildInDblArray(const double* numbers, int count)
 	int			i;
 
 	HandyJson* n = 0;
-	HandyJson* p = 0;
 	this->BuildInArray();
 	for (i = 0; i < count; ++i)
 	{
-		n = new HandyJson();
+		n = this->NewItem();
 		if (!n)
 			return ;
 		n->BuildInNumber(numbers[i]);
-		if (!i)
-			this->p_child = n;
-		else
-			p->SuffixItem(n);
-		p = n;
+		this->AppendChild(n);
 	}
 }
 
@@ -475,19 +884,14 @@ void			HandyJson::BuildInStrArray(const char** strings, int count)
 	int			i;
 
 	HandyJson* n = 0;
-	HandyJson* p = 0;
 	this->BuildInArray();
 	for (i = 0; i < count; ++i)
 	{
-		n = new HandyJson();
+		n = this->NewItem();
 		if (!n)
 			return ;
 		n->BuildInString(strings[i]);
-		if (!i)
-			this->p_child = n;
-		else
-			p->SuffixItem(n);
-		p = n;
+		this->AppendChild(n);
 	}
 }
 
@@ -497,34 +901,173 @@ const char*		HandyJson::GetErrorPtr(void)
 	return (HandyJson::sp_err);
 }
 
-const char*		HandyJson::ParseNumber(const char* num)
+const char*		HandyJson::GetErrorText(eErrors code)
 {
-	double		n = 0;
-	double		sign = 1;
-	double		scale = 0;
-	int			subscale = 0;
-	int			signsubscale = 1;
-
-	if (*num == '-')	{ sign = -1; ++num; }
-	if (*num == '0')	{ ++num; }
-	if (*num >= '1' && *num <= '9')
+	switch (code)
 	{
-		do
-		{
-			n = (n * 10.0) + (*num++ - '0');
-		} while (*num >= '0' && *num <= '9');
+		case json_error_none:		return ("No error");
+		case json_error_value:		return ("Invalid value");
+		case json_error_string:		return ("Invalid string");
+		case json_error_key:		return ("Object member name is not a string");
+		case json_error_colon:		return ("Missing ':' after an object member name");
+		case json_error_array:		return ("Missing ',' or ']' in array");
+		case json_error_object:		return ("Missing ',' or '}' in object");
+		case json_error_depth:		return ("Nesting too deep");
+		case json_error_trailing:	return ("Unexpected data after the value");
+		case json_error_handler:	return ("Stopped by the handler");
+		case json_error_memory:		return ("Out of memory");
+		case json_error_file:		return ("Can not read the file");
+		case json_error_type:		return ("A value does not have the expected type");
 	}
-	if (*num=='.' && num[1] >= '0' && num[1] <= '9')
-	{
-		num++;
-		do
+	return ("Unknown error");
+}
+
+const char*		HandyJson::Fail(ErrorContext& ctx, const char* where, eErrors code)
+{
+	ctx.where = where;
+	ctx.code = code;
+	return (0);
+}
+
+/*
+	End of every parse: check what follows the value, then report the outcome
+	to the caller and to GetErrorPtr(). Line and column are only counted on failure.
+*/
+bool			HandyJson::Finish(ErrorContext& ctx, const char* end, const char** return_parse_end, bool require_null_terminated, HandyJsonError* error)
+{
+	const char*	ptr;
+
+	if (end && require_null_terminated)
+	{
+		end = HandyJson::Skip(end);
+		if (*end)
+			end = HandyJson::Fail(ctx, end, json_error_trailing);
+	}
+	if (end)
+	{
+		HandyJson::sp_err = 0;
+		if (return_parse_end)
+			*return_parse_end = end;
+		if (error)
+		{
+			error->code = json_error_none;
+			error->offset = 0;
+			error->line = error->column = 0;
+		}
+		return (true);
+	}
+	if (!ctx.where)
+		HandyJson::Fail(ctx, ctx.start, json_error_memory);
+	HandyJson::sp_err = ctx.where;
+	if (error)
+	{
+		error->code = ctx.code;
+		error->offset = ctx.where - ctx.start;
+		error->line = 1;
+		error->column = 1;
+		for (ptr = ctx.start; ptr < ctx.where; ++ptr)
+		{
+			if (*ptr == '\n')
+			{
+				++error->line;
+				error->column = 1;
+			}
+			else
+				++error->column;
+		}
+	}
+	return (false);
+}
+
+void			HandyJson::SetMaxDepth(size_t depth)
+{
+	HandyJson::sp_max_depth = depth;
+}
+
+size_t			HandyJson::GetMaxDepth()
+{
+	return (HandyJson::sp_max_depth);
+}
+
+const char*		HandyJson::ParseNumber(const char* num)
+{
+	NumberValue	n;
+
+	num = this->ScanNumber(num, n);
+	this->SetNumber(n);
+    this->p_type = json_number;
+	return (num);
+}
+
+/* An integer is kept exactly, and a double otherwise: the getters convert */
+void			HandyJson::SetNumber(const NumberValue& n)
+{
+	this->p_flags &= ~(flag_int | flag_uint);
+	if (n.is_int)
+	{
+		this->p_value.i = (int64_t)n.bits;
+		this->p_flags |= n.is_uint ? (flag_int | flag_uint) : flag_int;
+	}
+	else
+		this->p_value.d = n.dbl;
+}
+
+const char*		HandyJson::ScanNumber(const char* num, NumberValue& out)
+{
+	const char*	start = num;
+	uint64_t	m = 0;			// The 19 first significant digits,
+	int64_t		exp10 = 0;		// and the value is m * 10^exp10.
+	uint64_t	u;				// The integer, on the fast path.
+	int			digits = 0;
+	int			dropped = 0;	// First digit which did not fit in m.
+	int			subscale = 0;
+	int			signsubscale = 1;
+	bool		neg = false;
+	bool		trunc = false;
+	bool		is_int = true;
+	double		d, d2;
+
+	if (*num == '-')	{ neg = true; ++num; }
+	if (*num == '0')	{ ++num; }
+	if (*num >= '1' && *num <= '9')
+	{
+		do
+		{
+			if (digits < 19)
+			{
+				m = (m * 10) + (*num - '0');
+				++digits;
+			}
+			else
+			{
+				if (!exp10++)
+					dropped = *num - '0';
+				trunc |= *num != '0';
+			}
+			++num;
+		} while (*num >= '0' && *num <= '9');
+	}
+	if (*num=='.' && num[1] >= '0' && num[1] <= '9')
+	{
+		is_int = false;
+		num++;
+		do
 		{
-			n = (n * 10.0) + (*num++ - '0');
-			scale--;
+			if (digits < 19)
+			{
+				m = (m * 10) + (*num - '0');
+				if (m)
+					++digits;
+				--exp10;
+			}
+			else
+				trunc |= *num != '0';
+			++num;
 		} while (*num >= '0' && *num <= '9');
 	}
 	if (*num == 'e' || *num == 'E')
 	{
+		is_int = false;
 		num++;
 		if (*num == '+')
 			num++;
@@ -533,520 +1076,5628 @@ const char*		HandyJson::ParseNumber(const char* num)
 			signsubscale = -1;
 			num++;
 		}
-		while (*num >= '0' && *num <= '9') subscale = (subscale * 10) + (*num++ - '0');
+		while (*num >= '0' && *num <= '9')
+		{
+			if (subscale < 100000)
+				subscale = (subscale * 10) + (*num - '0');
+			num++;
+		}
 	}
-	n = sign * n * pow(10.0, (scale + subscale * signsubscale));
-	this->p_value_as_int = (int)n;
-	this->p_value_as_dbl = n;
-    this->p_type = json_number;
+
+	out.is_int = false;
+	out.is_uint = false;
+	if (is_int && exp10 <= 1)		// Integer fast path: exact in 64 bits.
+	{
+		u = m;						// m and exp10 stay as they are for not_int.
+		if (exp10 == 1)
+		{
+			if (m > (UINT64_MAX - dropped) / 10)
+				goto not_int;
+			u = (m * 10) + dropped;
+		}
+		if (!neg)
+		{
+			out.bits = u;
+			out.is_uint = u > (uint64_t)INT64_MAX;
+			out.dbl = (double)u;
+		}
+		else if (u <= (uint64_t)1 << 63)
+		{
+			out.bits = (uint64_t)0 - u;		// Two's complement of u, INT64_MIN included.
+			out.dbl = u ? (double)(int64_t)out.bits : -0.0;
+		}
+		else
+			goto not_int;
+		out.is_int = true;
+		return (num);
+	}
+
+not_int:
+	exp10 += subscale * signsubscale;
+	if (!m)
+		d = 0;
+	else if (!trunc && m <= (uint64_t)1 << 53 && exp10 >= -22 && exp10 <= 22)		// Exact operands, one rounding.
+		d = exp10 < 0 ? (double)m / HandyJson::sp_pow10[-exp10] : (double)m * HandyJson::sp_pow10[exp10];
+	else if (!HandyJson::EiselLemire(exp10, m, d) ||
+			(trunc && (!HandyJson::EiselLemire(exp10, m + 1, d2) || d != d2)))		// Dropped digits matter.
+	{
+		out.dbl = HandyJson::SlowNumber(start, num);		// Sign included.
+		return (num);
+	}
+	out.dbl = neg ? -d : d;
 	return (num);
 }
 
-char*			HandyJson::PrintNumber() const
+static inline uint64_t	Mul128(uint64_t a, uint64_t b, uint64_t* hi)
+{
+#if defined(__SIZEOF_INT128__)
+	unsigned __int128	r = (unsigned __int128)a * b;
+
+	*hi = (uint64_t)(r >> 64);
+	return ((uint64_t)r);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return (_umul128(a, b, hi));
+#else
+	uint64_t	a_lo = (uint32_t)a, a_hi = a >> 32;
+	uint64_t	b_lo = (uint32_t)b, b_hi = b >> 32;
+	uint64_t	p0 = a_lo * b_lo, p1 = a_lo * b_hi, p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+	uint64_t	mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;
+
+	*hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+	return ((mid << 32) | (uint32_t)p0);
+#endif
+}
+
+static inline int		LeadingZeros(uint64_t u)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (__builtin_clzll(u));
+#else
+	int		n = 0;
+
+	while (!(u & ((uint64_t)1 << 63)))
+	{
+		u <<= 1;
+		++n;
+	}
+	return (n);
+#endif
+}
+
+/*
+	Eisel-Lemire: the nearest double to w * 10^q, with w != 0 and at most 19 digits.
+	Returns false in the very rare cases where the 128 bits product is not precise
+	enough to decide the rounding.
+*/
+bool			HandyJson::EiselLemire(int64_t q, uint64_t w, double& out)
+{
+	uint64_t	lo, hi, hi2, mantissa, bits;
+	int64_t		power2;
+	int			lz, upperbit, shift, index;
+
+	if (q < -342) { out = 0; return (true); }
+	if (q > 308) { out = HUGE_VAL; return (true); }
+	lz = LeadingZeros(w);
+	w <<= lz;
+	index = 2 * (int)(q + 342);
+	lo = Mul128(w, HandyJson::sp_pow5_128[index], &hi);
+	if ((hi & 0x1FF) == 0x1FF)		// The low bits may carry into the 55 bits we keep.
+	{
+		Mul128(w, HandyJson::sp_pow5_128[index + 1], &hi2);
+		lo += hi2;
+		if (hi2 > lo)
+			++hi;
+	}
+	if (lo == UINT64_MAX && (q < -27 || q > 55))
+		return (false);
+	upperbit = (int)(hi >> 63);
+	shift = upperbit + 64 - 52 - 3;
+	mantissa = hi >> shift;
+	power2 = (((152170 + 65536) * q) >> 16) + 63 + upperbit - lz + 1023;
+	if (power2 <= 0)		// Subnormal.
+	{
+		if (-power2 + 1 >= 64) { out = 0; return (true); }
+		mantissa >>= -power2 + 1;
+		mantissa += (mantissa & 1);
+		mantissa >>= 1;
+		power2 = (mantissa < ((uint64_t)1 << 52)) ? 0 : 1;
+	}
+	else
+	{
+		if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == hi)
+			mantissa &= ~(uint64_t)1;		// Exactly halfway: round to even.
+		mantissa += (mantissa & 1);
+		mantissa >>= 1;
+		if (mantissa >= ((uint64_t)2 << 52))
+		{
+			mantissa = (uint64_t)1 << 52;
+			++power2;
+		}
+		mantissa &= ~((uint64_t)1 << 52);
+		if (power2 >= 0x7FF) { out = HUGE_VAL; return (true); }
+	}
+	bits = mantissa | ((uint64_t)power2 << 52);
+	memcpy(&out, &bits, sizeof(out));
+	return (true);
+}
+
+/* Last resort for numbers the fast paths can not round: the C library. */
+double			HandyJson::SlowNumber(const char* start, const char* end)
+{
+	char		local[128];
+	char*		buf = local;
+	char*		ptr;
+	const char*	point = localeconv()->decimal_point;
+	size_t		plen = strlen(point);
+	double		d;
+
+	if ((size_t)(end - start) * plen + 1 > sizeof(local) && !(buf = new char[(end - start) * plen + 1]))
+		return (0);
+	for (ptr = buf; start < end; ++start)
+	{
+		if (*start == '.')		// strtod() reads the decimal point of the current locale.
+		{
+			memcpy(ptr, point, plen);
+			ptr += plen;
+		}
+		else
+			*ptr++ = *start;
+	}
+	*ptr = 0;
+	d = strtod(buf, 0);
+	if (buf != local)
+		delete[] (buf);
+	return (d);
+}
+
+bool			HandyJson::PrintNumber(PrintBuffer& pb) const
+{
+	char*		ptr;
+
+	if (!pb.Reserve(32))
+		return (false);
+	ptr = pb.buf + pb.len;
+	if (this->p_flags & flag_uint)
+		ptr = this->WriteUInt64(ptr, (uint64_t)this->p_value.i);
+	else if (this->p_flags & flag_int)
+	{
+		if (this->p_value.i < 0)
+		{
+			*ptr++ = '-';
+			ptr = this->WriteUInt64(ptr, (uint64_t)0 - (uint64_t)this->p_value.i);
+		}
+		else
+			ptr = this->WriteUInt64(ptr, (uint64_t)this->p_value.i);
+	}
+	else
+		ptr = this->WriteDouble(ptr, this->p_value.d);
+	pb.len = ptr - pb.buf;
+	return (true);
+}
+
+char*			HandyJson::WriteUInt64(char* out, uint64_t u)
+{
+	int			len = 1;
+	uint64_t	t = u;
+	char*		ptr;
+
+	while (t >= 100) { t /= 100; len += 2; }
+	if (t >= 10) ++len;
+	ptr = out + len;
+	while (u >= 100)
+	{
+		unsigned	i = (unsigned)(u % 100) * 2;
+
+		u /= 100;
+		*--ptr = HandyJson::sp_digit_pairs[i + 1];
+		*--ptr = HandyJson::sp_digit_pairs[i];
+	}
+	if (u >= 10)
+	{
+		*--ptr = HandyJson::sp_digit_pairs[u * 2 + 1];
+		*--ptr = HandyJson::sp_digit_pairs[u * 2];
+	}
+	else
+		*--ptr = (char)('0' + u);
+	return (out + len);
+}
+
+/*
+	Shortest digits of d which read back to d, laid out like JavaScript does:
+	plain decimals for 1e-6 <= |d| < 1e21, scientific notation otherwise.
+	Integral values have no fraction part, non finite values become null.
+*/
+char*			HandyJson::WriteDouble(char* out, double d)
 {
-	char		*str;
-	double		d = this->p_value_as_dbl;
+	char		digits[24];
+	int			len, k, kk, i;
 
-	if (fabs(((double)this->p_value_as_int)-d) <= DBL_EPSILON && d <= INT_MAX && d >= INT_MIN)
+	if (d != d || d - d != d - d)		// NaN or infinity.
+	{
+		memcpy(out, "null", 4);
+		return (out + 4);
+	}
+	if (d == 0)
+	{
+		*out = '0';
+		return (out + 1);
+	}
+	if (d < 0)
+	{
+		*out++ = '-';
+		d = -d;
+	}
+	HandyJson::Grisu2(d, digits, len, k);
+	kk = len + k;		// 10^(kk-1) <= d < 10^kk
+	if (k >= 0 && kk <= 21)		// 1234e7 -> 12340000000
+	{
+		memcpy(out, digits, len);
+		memset(out + len, '0', k);
+		return (out + kk);
+	}
+	if (kk > 0 && kk <= 21)		// 1234e-2 -> 12.34
+	{
+		memcpy(out, digits, kk);
+		out[kk] = '.';
+		memcpy(out + kk + 1, digits + kk, len - kk);
+		return (out + len + 1);
+	}
+	if (kk > -6 && kk <= 0)		// 1234e-6 -> 0.001234
+	{
+		out[0] = '0';
+		out[1] = '.';
+		memset(out + 2, '0', -kk);
+		memcpy(out + 2 - kk, digits, len);
+		return (out + 2 - kk + len);
+	}
+	*out++ = digits[0];			// 1234e30 -> 1.234e33
+	if (len > 1)
+	{
+		*out++ = '.';
+		memcpy(out, digits + 1, len - 1);
+		out += len - 1;
+	}
+	*out++ = 'e';
+	i = kk - 1;
+	if (i < 0)
 	{
-		str = new char[21]();
-		if (str) sprintf(str, "%d", this->p_value_as_int);
+		*out++ = '-';
+		i = -i;
+	}
+	if (i >= 100)
+	{
+		*out++ = (char)('0' + i / 100);
+		i %= 100;
+		*out++ = HandyJson::sp_digit_pairs[i * 2];
+		*out++ = HandyJson::sp_digit_pairs[i * 2 + 1];
+	}
+	else if (i >= 10)
+	{
+		*out++ = HandyJson::sp_digit_pairs[i * 2];
+		*out++ = HandyJson::sp_digit_pairs[i * 2 + 1];
 	}
 	else
+		*out++ = (char)('0' + i);
+	return (out);
+}
+
+/*
+	Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+	with Integers"), with the digit generation and rounding of Milo Yip's version.
+	The output always reads back to the same double, and is the shortest one in
+	the vast majority of cases.
+*/
+struct			HandyJson::DiyFp
+{
+	uint64_t	f;
+	int			e;
+
+	DiyFp() : f(0), e(0) {}
+	DiyFp(uint64_t fp, int exp) : f(fp), e(exp) {}
+
+	explicit DiyFp(double d)
+	{
+		uint64_t	bits;
+		int			biased_e;
+
+		memcpy(&bits, &d, sizeof(bits));
+		biased_e = (int)((bits >> 52) & 0x7FF);
+		this->f = bits & (((uint64_t)1 << 52) - 1);
+		if (biased_e)
+		{
+			this->f += (uint64_t)1 << 52;
+			this->e = biased_e - 1075;
+		}
+		else
+			this->e = -1074;
+	}
+
+	DiyFp		operator-(const DiyFp& rhs) const
+	{
+		return (DiyFp(this->f - rhs.f, this->e));
+	}
+
+	DiyFp		operator*(const DiyFp& rhs) const
+	{
+		uint64_t	hi;
+		uint64_t	lo = Mul128(this->f, rhs.f, &hi);
+
+		if (lo & ((uint64_t)1 << 63))		// Round.
+			++hi;
+		return (DiyFp(hi, this->e + rhs.e + 64));
+	}
+
+	DiyFp		Normalize() const
+	{
+		int			s = LeadingZeros(this->f);
+
+		return (DiyFp(this->f << s, this->e - s));
+	}
+
+	void		NormalizedBoundaries(DiyFp& minus, DiyFp& plus) const
+	{
+		DiyFp		pl((this->f << 1) + 1, this->e - 1);
+		DiyFp		mi;
+
+		while (!(pl.f & ((uint64_t)1 << 53)))
+		{
+			pl.f <<= 1;
+			pl.e--;
+		}
+		pl.f <<= 10;
+		pl.e -= 10;
+		if (this->f == (uint64_t)1 << 52)		// The lower boundary is closer.
+			mi = DiyFp((this->f << 2) - 1, this->e - 2);
+		else
+			mi = DiyFp((this->f << 1) - 1, this->e - 1);
+		mi.f <<= mi.e - pl.e;
+		mi.e = pl.e;
+		plus = pl;
+		minus = mi;
+	}
+};
+
+void			HandyJson::Grisu2(double value, char* buffer, int& len, int& k)
+{
+	const DiyFp	v(value);
+	DiyFp		w_m, w_p;
+	double		dk;
+	int			ik;
+	unsigned	index;
+
+	v.NormalizedBoundaries(w_m, w_p);
+	dk = (-61 - w_p.e) * 0.30102999566398114 + 347;		// Cached power bringing w_p.e in [-60, -32].
+	ik = (int)dk;
+	if (dk - ik > 0.0)
+		ik++;
+	index = (unsigned)((ik >> 3) + 1);
+	k = -(-348 + (int)(index << 3));
+
+	const DiyFp	c_mk(HandyJson::sp_cached_pow_f[index], HandyJson::sp_cached_pow_e[index]);
+	const DiyFp	W = v.Normalize() * c_mk;
+	DiyFp		Wp = w_p * c_mk;
+	DiyFp		Wm = w_m * c_mk;
+
+	Wm.f++;
+	Wp.f--;
+	HandyJson::DigitGen(W, Wp, Wp.f - Wm.f, buffer, len, k);
+}
+
+static inline void		GrisuRound(char* buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+	while (rest < wp_w && delta - rest >= ten_kappa &&
+		(rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+	{
+		buffer[len - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+void			HandyJson::DigitGen(const DiyFp& W, const DiyFp& Mp, uint64_t delta, char* buffer, int& len, int& k)
+{
+	static const uint64_t	pow10[] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+		100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+		100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+		1000000000000000000ULL, 10000000000000000000ULL };
+	const DiyFp				one((uint64_t)1 << -Mp.e, Mp.e);
+	const DiyFp				wp_w = Mp - W;
+	uint32_t				p1 = (uint32_t)(Mp.f >> -one.e);
+	uint64_t				p2 = Mp.f & (one.f - 1);
+	int						kappa = 1;
+	uint32_t				d;
+	uint64_t				tmp;
+
+	while (kappa < 10 && p1 >= pow10[kappa])
+		++kappa;
+	len = 0;
+	while (kappa > 0)
+	{
+		d = p1 / (uint32_t)pow10[kappa - 1];
+		p1 %= (uint32_t)pow10[kappa - 1];
+		if (d || len)
+			buffer[len++] = (char)('0' + d);
+		kappa--;
+		tmp = ((uint64_t)p1 << -one.e) + p2;
+		if (tmp <= delta)
+		{
+			k += kappa;
+			GrisuRound(buffer, len, delta, tmp, pow10[kappa] << -one.e, wp_w.f);
+			return;
+		}
+	}
+	for (;;)
 	{
-		str = new char[64]();
-		if (str)
+		p2 *= 10;
+		delta *= 10;
+		d = (uint32_t)(p2 >> -one.e);
+		if (d || len)
+			buffer[len++] = (char)('0' + d);
+		p2 &= one.f - 1;
+		kappa--;
+		if (p2 < delta)
 		{
-			if (fabs(floor(d) - d) <= DBL_EPSILON && fabs(d) < 1.0e60) sprintf(str, "%.0f", d);
-			else if (fabs(d) < 1.0e-6 || fabs(d) > 1.0e9) sprintf(str, "%e", d);
-			else sprintf(str, "%f", d);
+			k += kappa;
+			GrisuRound(buffer, len, delta, p2, one.f, wp_w.f * (-kappa < 20 ? pow10[-kappa] : 0));
+			return;
 		}
 	}
-	return (str);
 }
 
-unsigned		HandyJson::ParseHex4(const char* str)
+unsigned		HandyJson::ParseHex4(const char* str)
+{
+	unsigned h = 0;
+
+	if (*str >= '0' && *str <= '9') h += (*str) - '0';
+	else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
+	else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
+	else return (0);
+
+	h = h << 4;
+	++str;
+
+	if (*str >= '0' && *str <= '9') h += (*str) - '0';
+	else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
+	else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
+	else return (0);
+
+	h = h << 4;
+	++str;
+
+	if (*str >= '0' && *str <= '9') h += (*str) - '0';
+	else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
+	else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
+	else return (0);
+
+	h = h << 4;
+	++str;
+	
+	if (*str >= '0' && *str <= '9') h += (*str) - '0';
+	else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
+	else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
+	else return (0);
+
+	return (h);
+}
+
+/* Fills an empty item, see ClearValue() */
+const char*		HandyJson::ParseString(const char* str, ParseContext& ctx)
+{
+	const char*	ptr = str + 1;
+	char*		ptr2;
+	char*		out;
+	size_t		len, size;
+
+	if (*str!='\"')	{ return (HandyJson::Fail(ctx, str, json_error_string)); }
+	
+	ptr = this->ScanString(ptr);		// Escape free prefix.
+	len = ptr - str - 1;
+	if (ctx.in_situ)
+		out = (char*)str + 1;		// Decoded bytes never outgrow the escaped ones.
+	else
+	{
+		size = len + this->StringLength(ptr);
+		if (size < sizeof(this->p_value.str.in))
+			out = this->p_value.str.in;		// Short, decoded in the item itself.
+		else if (!(out = this->AllocStr(size + 1)))
+			return (HandyJson::Fail(ctx, str, json_error_memory));
+		memcpy(out, str + 1, len);
+	}
+	ptr2 = out + len;
+	ptr = this->DecodeString(ptr, ptr2);
+	if (*ptr != '\"')
+	{
+		HandyJson::Fail(ctx, str, json_error_string);
+		if (!ctx.in_situ && !this->p_arena && out != this->p_value.str.in)
+			delete[] (out);
+		memset(&this->p_value, 0, sizeof(Value));		// The item may be an empty container.
+		return (0);
+	}
+	*ptr2 = 0;		// In situ, this may overwrite the closing quote.
+	if (out == this->p_value.str.in)
+	{
+		this->p_value.str.in[15] = (char)(15 - (ptr2 - out));
+		this->p_flags |= flag_str_in;
+	}
+	else
+	{
+		this->p_value.str.out.ptr = out;
+		this->p_value.str.out.len = (unsigned int)(ptr2 - out);
+		if (ctx.in_situ)
+			this->p_flags |= flag_str_ref;
+	}
+    this->p_type = json_string;
+	return (ptr + 1);
+}
+
+/* The name of a child: a name without escapes goes to the pool straight from the text */
+const char*		HandyJson::ParseKey(const char* str, ParseContext& ctx)
+{
+	const char*	end;
+	bool		ok;
+
+	if (!ctx.keys)
+	{
+		if ((str = this->ParseString(str, ctx)))
+			this->TakeNameFromValStr();
+		return (str);
+	}
+	end = this->ScanString(str + 1);
+	if (*end == '\"')
+		return (this->PoolName(*ctx.keys, str + 1, end - str - 1) ? end + 1 : HandyJson::Fail(ctx, str, json_error_memory));
+	if (!(end = this->ParseString(str, ctx)))
+		return (0);
+	ok = this->PoolName(*ctx.keys, this->GetValStr(), this->GetValStrLen());
+	this->FreeValStr();
+	return (ok ? end : HandyJson::Fail(ctx, str, json_error_memory));
+}
+
+size_t			HandyJson::StringLength(const char* ptr)
+{
+	size_t		len = 0;
+	const char*	run;
+
+	while (*ptr != '\"' && *ptr)
+	{
+		if (*ptr == '\\')
+		{
+			++len;
+			if (*++ptr == 'u' && ptr[1] && ptr[2] && ptr[3] && ptr[4])
+			{
+				len += 4;		// DecodeString() takes them whatever they are, quotes included.
+				ptr += 4;
+			}
+			if (*ptr)
+				++ptr;
+		}
+		else
+		{
+			run = HandyJson::ScanString(ptr);
+			len += run - ptr;
+			ptr = run;
+		}
+	}
+	return (len);
+}
+
+const char*		HandyJson::DecodeString(const char* ptr, char*& ptr2)
+{
+	int			len;
+	unsigned	uc,uc2;
+
+	const char*	run;
+
+	while (*ptr!='\"' && *ptr)
+	{
+		if (*ptr != '\\')
+		{
+			run = HandyJson::ScanString(ptr);
+			memmove(ptr2, ptr, run - ptr);		// In situ, ptr2 may run behind ptr in the same buffer.
+			ptr2 += run - ptr;
+			ptr = run;
+		}
+		else
+		{
+			ptr++;
+			switch (*ptr)
+			{
+				case 'b': *ptr2++='\b';	break;
+				case 'f': *ptr2++='\f';	break;
+				case 'n': *ptr2++='\n';	break;
+				case 'r': *ptr2++='\r';	break;
+				case 't': *ptr2++='\t';	break;
+				case 'u':
+					if (!ptr[1] || !ptr[2] || !ptr[3] || !ptr[4]) { ptr += strlen(ptr) - 1; break; }	// Truncated escape.
+					uc = HandyJson::ParseHex4(ptr + 1); ptr += 4;
+					if ((uc >= 0xDC00 && uc <= 0xDFFF) || uc == 0) break;
+					if (uc >= 0xD800 && uc <= 0xDBFF)
+					{
+						if (ptr[1] != '\\' || ptr[2] != 'u') break;
+						if (!ptr[3] || !ptr[4] || !ptr[5] || !ptr[6]) { ptr += strlen(ptr) - 1; break; }
+						uc2 = HandyJson::ParseHex4(ptr+3); ptr += 6;
+						if (uc2 < 0xDC00 || uc2 > 0xDFFF) break;
+						uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
+					}
+					len = 4;
+					if (uc < 0x80) len = 1;
+					else if (uc < 0x800) len = 2;
+					else if (uc < 0x10000) len = 3;
+					ptr2 += len;
+					
+					switch (len) {
+						case 4: *--ptr2 = ((uc | 0x80) & 0xBF); uc >>= 6;
+						case 3: *--ptr2 = ((uc | 0x80) & 0xBF); uc >>= 6;
+						case 2: *--ptr2 = ((uc | 0x80) & 0xBF); uc >>= 6;
+						case 1: *--ptr2 = (uc | HandyJson::sp_firstByteMark[len]);
+					}
+					ptr2 += len;
+					break;
+				case 0:
+					--ptr;
+					break;
+				default: 
+					*ptr2++ = *ptr; 
+					break;
+			}
+			ptr++;
+		}
+	}
+	return (ptr);
+}
+
+const char*		HandyJson::SaxString(const char* str, SaxContext& ctx, bool key)
+{
+	const char*	ptr = str + 1;
+	char*		ptr2;
+	size_t		len;
+	bool		ok;
+
+	if (*str!='\"')	{ return (HandyJson::Fail(ctx, str, key ? json_error_key : json_error_string)); }
+
+	ptr = HandyJson::ScanString(ptr);
+	len = ptr - str - 1;
+	if (*ptr == '\"')		// Nothing to decode, the event gets the input itself.
+		ok = key ? ctx.handler->Key(str + 1, len) : ctx.handler->String(str + 1, len);
+	else
+	{
+		size_t	need = len + HandyJson::StringLength(ptr) + 1;
+
+		if (need > ctx.size)
+		{
+			delete[] (ctx.scratch);
+			ctx.size = need < 256 ? 256 : need;
+			if (!(ctx.scratch = new char[ctx.size]))
+				return (HandyJson::Fail(ctx, str, json_error_memory));
+		}
+		memcpy(ctx.scratch, str + 1, len);
+		ptr2 = ctx.scratch + len;
+		ptr = HandyJson::DecodeString(ptr, ptr2);
+		if (*ptr != '\"') { return (HandyJson::Fail(ctx, str, json_error_string)); }
+		*ptr2 = 0;
+		len = ptr2 - ctx.scratch;
+		ok = key ? ctx.handler->Key(ctx.scratch, len) : ctx.handler->String(ctx.scratch, len);
+	}
+	if (!ok) { return (HandyJson::Fail(ctx, str, json_error_handler)); }
+	return (ptr + 1);
+}
+
+/*
+	Same walk as ParseValue(), the open containers are only remembered by
+	their opening character.
+*/
+const char*		HandyJson::SaxValue(const char* value, SaxContext& ctx)
+{
+	size_t		depth = 0;
+	char*		stack;
+	char		open;
+
+	for (;;)
+	{
+		/* One value */
+		if (!value)
+			return (0);
+		if (*value == '[' || *value == '{')
+		{
+			open = *value;
+			if (depth == ctx.max_depth) { return (HandyJson::Fail(ctx, value, json_error_depth)); }
+			if (!(open == '[' ? ctx.handler->StartArray() : ctx.handler->StartObject())) { return (HandyJson::Fail(ctx, value, json_error_handler)); }
+			value = HandyJson::Skip(value + 1);
+			if (*value == (open == '[' ? ']' : '}'))
+			{
+				if (!(open == '[' ? ctx.handler->EndArray() : ctx.handler->EndObject())) { return (HandyJson::Fail(ctx, value, json_error_handler)); }
+				++value;
+			}
+			else
+			{
+				if (depth == ctx.stack_size)
+				{
+					ctx.stack_size = depth ? depth * 2 : 32;
+					if (!(stack = new char[ctx.stack_size]))
+						return (HandyJson::Fail(ctx, value, json_error_memory));
+					if (depth)
+						memcpy(stack, ctx.stack, depth);
+					delete[] (ctx.stack);
+					ctx.stack = stack;
+				}
+				ctx.stack[depth++] = open;
+				if (open == '{')
+				{
+					value = HandyJson::Skip(HandyJson::SaxString(value, ctx, true));
+					if (!value)
+						return (0);
+					if (*value != ':') { return (HandyJson::Fail(ctx, value, json_error_colon)); }
+					value = HandyJson::Skip(value + 1);
+				}
+				continue;
+			}
+		}
+		else
+			value = HandyJson::SaxScalar(value, ctx);
+
+		/* Close the containers ending here, until one has a next value */
+		for (;;)
+		{
+			if (!value || !depth)
+				return (value);
+			open = ctx.stack[depth - 1];
+			value = HandyJson::Skip(value);
+			if (*value == ',')
+			{
+				value = HandyJson::Skip(value + 1);
+				if (open == '{')
+				{
+					value = HandyJson::Skip(HandyJson::SaxString(value, ctx, true));
+					if (!value)
+						return (0);
+					if (*value != ':') { return (HandyJson::Fail(ctx, value, json_error_colon)); }
+					value = HandyJson::Skip(value + 1);
+				}
+				break;
+			}
+			if (*value != (open == '[' ? ']' : '}')) { return (HandyJson::Fail(ctx, value, open == '[' ? json_error_array : json_error_object)); }
+			if (!(open == '[' ? ctx.handler->EndArray() : ctx.handler->EndObject())) { return (HandyJson::Fail(ctx, value, json_error_handler)); }
+			--depth;
+			++value;
+		}
+	}
+}
+
+const char*		HandyJson::SaxScalar(const char* value, SaxContext& ctx)
+{
+	NumberValue	n;
+	bool		ok;
+	const char*	end;
+
+	if (!strncmp(value, "null", 4))		{ ok = ctx.handler->Null(); end = value + 4; }
+	else if (!strncmp(value, "false", 5))	{ ok = ctx.handler->Bool(false); end = value + 5; }
+	else if (!strncmp(value, "true", 4))	{ ok = ctx.handler->Bool(true); end = value + 4; }
+	else if (*value == '\"')				{ return (HandyJson::SaxString(value, ctx, false)); }
+	else if (*value == '-' || (*value >= '0' && *value <= '9'))
+	{
+		end = HandyJson::ScanNumber(value, n);
+		if (!n.is_int)			ok = ctx.handler->Number(n.dbl);
+		else if (n.is_uint)		ok = ctx.handler->UInt64(n.bits);
+		else					ok = ctx.handler->Int64((int64_t)n.bits);
+	}
+	else								{ return (HandyJson::Fail(ctx, value, json_error_value)); }
+
+	if (!ok) { return (HandyJson::Fail(ctx, value, json_error_handler)); }
+	return (end);
+}
+
+bool			HandyJson::PrintStringPtr(PrintBuffer& pb, const char* str) const
+{
+	const char*		ptr;
+	char*			ptr2;
+	size_t			len = 0;
+	unsigned char	token;
+	
+	if (!str) return (false);
+	ptr = str;
+	while ((token = *ptr) && ++len) 
+	{
+		if (strchr("\"\\\b\f\n\r\t", token))
+			len++;
+		else if (token < 32) 
+			len += 5;
+		ptr++;
+	}
+	if (!pb.Reserve(len + 2)) return (false);
+
+	ptr2 = pb.buf + pb.len;
+	ptr = str;
+	*ptr2++ = '\"';
+	while (*ptr)
+	{
+		if ((unsigned char)*ptr > 31 && *ptr != '\"' && *ptr != '\\')
+			*ptr2++ = *ptr++;
+		else
+		{
+			*ptr2++ = '\\';
+			switch (token = *ptr++)
+			{
+				case '\\':	*ptr2++='\\';	break;
+				case '\"':	*ptr2++='\"';	break;
+				case '\b':	*ptr2++='b';	break;
+				case '\f':	*ptr2++='f';	break;
+				case '\n':	*ptr2++='n';	break;
+				case '\r':	*ptr2++='r';	break;
+				case '\t':	*ptr2++='t';	break;
+				default:
+					sprintf(ptr2, "u%04x", token);
+					ptr2 += 5;
+					break;
+			}
+		}
+	}
+	*ptr2++  ='\"';
+	pb.len = ptr2 - pb.buf;
+	return (true);
+}
+
+/*
+	The parser does not recurse: the arrays and objects being filled are kept
+	on ctx.stack, so deep data costs heap memory instead of call stack, and
+	fails cleanly past ctx.max_depth.
+*/
+const char*		HandyJson::ParseValue(const char* value, ParseContext& ctx)
+{
+	HandyJson*	item = this;
+	HandyJson*	parent;
+	HandyJson**	stack;
+	size_t		depth = 0;
+	char		close;
+
+	for (;;)
+	{
+		/* One value, in item */
+		if (!value)
+			return (0);
+		if (!strncmp(value, "null", 4))			{ item->p_type = json_null; value += 4; }
+		else if (!strncmp(value, "false", 5))	{ item->p_type = json_false; value += 5; }
+		else if (!strncmp(value, "true", 4))	{ item->p_type = json_true; item->p_value.i = 1; value += 4; }
+		else if (*value == '\"')				{ value = item->ParseString(value, ctx); }
+		else if (*value == '-' || (*value >= '0' && *value <= '9')) { value = item->ParseNumber(value); }
+		else if (*value == '[' || *value == '{')
+		{
+			if (depth == ctx.max_depth) { return (HandyJson::Fail(ctx, value, json_error_depth)); }
+			item->p_type = (*value == '[') ? json_array : json_object;
+			close = (*value == '[') ? ']' : '}';
+			item->ResetChildren();
+			value = this->Skip(value + 1);
+			if (*value == close)
+				++value;
+			else
+			{
+				if (depth == ctx.stack_size)
+				{
+					ctx.stack_size = depth ? depth * 2 : 32;
+					if (!(stack = new HandyJson*[ctx.stack_size]))
+						return (HandyJson::Fail(ctx, value, json_error_memory));
+					if (depth)
+						memcpy(stack, ctx.stack, depth * sizeof(HandyJson*));
+					delete[] (ctx.stack);
+					ctx.stack = stack;
+				}
+				ctx.stack[depth++] = item;
+				value = item->ParseChild(value, item, ctx);
+				continue;
+			}
+		}
+		else
+			return (HandyJson::Fail(ctx, value, json_error_value));
+
+		/* Close the containers ending here, until one has a next child */
+		for (;;)
+		{
+			if (!value || !depth)
+				return (value);
+			parent = ctx.stack[depth - 1];
+			value = this->Skip(value);
+			if (*value == ',')
+			{
+				value = parent->ParseChild(this->Skip(value + 1), item, ctx);
+				break;
+			}
+			if (*value != (parent->GetType() == json_array ? ']' : '}'))
+				return (HandyJson::Fail(ctx, value, parent->GetType() == json_array ? json_error_array : json_error_object));
+			--depth;
+			++value;
+		}
+	}
+}
+
+/* Append a child to an array or an object, and read its name in an object */
+const char*		HandyJson::ParseChild(const char* value, HandyJson*& child, ParseContext& ctx)
+{
+	HandyJson*	item;
+
+	if (!(item = this->NewItem()))
+		return (HandyJson::Fail(ctx, value, json_error_memory));
+	this->AppendChild(item);
+	child = item;
+	if (this->GetType() != json_object)
+		return (value);
+	if (*value != '\"')
+		return (HandyJson::Fail(ctx, value, json_error_key));
+	value = this->Skip(item->ParseKey(value, ctx));
+	if (!value)
+		return (0);
+	if (*value != ':') { return (HandyJson::Fail(ctx, value, json_error_colon)); }
+	return (this->Skip(value + 1));
+}
+
+bool			HandyJson::PrintValue(PrintBuffer& pb, int depth, int fmt) const
+{
+	switch (this->GetType())
+	{
+    case json_null	:		return (pb.Put("null", 4));
+    case json_false	:		return (pb.Put("false", 5));
+    case json_true	:		return (pb.Put("true", 4));
+    case json_number	:		return (this->PrintNumber(pb));
+    case json_string	:		return (this->PrintStringPtr(pb, this->GetValStr()));
+    case json_array	:		return (this->PrintArray(pb, depth, fmt));
+    case json_object	:		return (this->PrintObject(pb, depth, fmt));
+	}
+	return (false);
+}
+
+bool			HandyJson::PrintArray(PrintBuffer& pb, int depth, int fmt) const
+{
+	HandyJson*	child = this->GetChild();
+
+	if (!pb.Put('['))
+		return (false);
+	while (child)
+	{
+		if (!child->PrintValue(pb, depth + 1, fmt))
+			return (false);
+		child = child->GetNext();
+		if (child && !(fmt ? pb.Put(", ", 2) : pb.Put(',')))
+			return (false);
+	}
+	return (pb.Put(']'));
+}
+
+bool			HandyJson::PrintObject(PrintBuffer& pb, int depth, int fmt) const
+{
+	HandyJson*	child = this->GetChild();
+
+	if (!child)
+	{
+		if (!pb.Put('{'))
+			return (false);
+		if (fmt && (!pb.Put('\n') || !pb.PutTabs(depth - 1)))
+			return (false);
+		return (pb.Put('}'));
+	}
+	++depth;
+	if (!pb.Put('{') || (fmt && !pb.Put('\n')))
+		return (false);
+	while (child)
+	{
+		if (fmt && !pb.PutTabs(depth))
+			return (false);
+		if (!child->PrintStringPtr(pb, child->GetName()) || !pb.Put(':'))
+			return (false);
+		if (fmt && !pb.Put('\t'))
+			return (false);
+		if (!child->PrintValue(pb, depth, fmt))
+			return (false);
+		child = child->GetNext();
+		if (child && !pb.Put(','))
+			return (false);
+		if (fmt && !pb.Put('\n'))
+			return (false);
+	}
+	if (fmt && !pb.PutTabs(depth - 1))
+		return (false);
+	return (pb.Put('}'));
+}
+
+void			HandyJson::SuffixItem(HandyJson* item)
+{
+	this->p_next = item;
+	item->p_prev = this;
+}
+
+/* The first child links back to the last one, which has no next */
+void			HandyJson::AppendChild(HandyJson* item)
+{
+	HandyJson*	first = this->p_value.kids.first;
+
+	if (!first)
+	{
+		this->p_value.kids.first = item;
+		item->p_prev = item;
+	}
+	else
+	{
+		first->p_prev->SuffixItem(item);
+		first->p_prev = item;
+	}
+	++this->p_size;
+	if (this->Items())
+		this->ItemsPush(item);
+	if (this->Keys())
+		this->IndexAdd(item, true);
+}
+
+HandyJson*		HandyJson::DetachItem(HandyJson* c, int pos)
+{
+	HandyJson*	first = this->p_value.kids.first;
+
+	if (this->Keys())
+		this->IndexRemove(c);
+	if (this->Items())
+		this->ItemsRemove(c, pos);
+	if (c == first)
+	{
+		if ((this->p_value.kids.first = c->p_next))
+			c->p_next->p_prev = c->p_prev;
+	}
+	else
+	{
+		c->p_prev->p_next = c->p_next;
+		(c->p_next ? c->p_next : first)->p_prev = c->p_prev;
+	}
+	--this->p_size;
+	c->p_prev = c->p_next = 0;
+	return (c);
+}
+
+void			HandyJson::ReplaceItem(HandyJson* c, HandyJson* newitem, int pos)
+{
+	HandyJson*	first = this->p_value.kids.first;
+	HandyJson**	items;
+
+	if (this->Keys())
+		this->IndexRemove(c);
+	newitem->p_next = c->p_next;
+	newitem->p_prev = (c->p_prev == c) ? newitem : c->p_prev;
+	if (c == first)
+		this->p_value.kids.first = newitem;
+	else
+		newitem->p_prev->p_next = newitem;
+	if (newitem->p_next)
+		newitem->p_next->p_prev = newitem;
+	else if (c != first)
+		first->p_prev = newitem;		// The new last child.
+	if (this->Items())
+	{
+		items = this->Items()->items;
+		if (pos < 0)
+			for (pos = 0; items[pos] != c; ++pos) ;
+		items[pos] = newitem;
+	}
+	if (this->Keys())
+		this->IndexAdd(newitem, false);
+	c->p_next = 0;
+	c->p_prev = 0;
+	if (!c->GetArena())
+		delete (c);
+}
+
+void			HandyJson::ResetChildren()
+{
+	this->IndexDrop();
+	this->ItemsDrop();
+	this->p_value.kids.first = 0;
+	this->p_size = 0;
+}
+
+/* Allocation functions */
+HandyJson*		HandyJson::NewItem() const
+{
+	if (this->p_arena)
+		return (this->p_arena->NewItem());
+	return (new HandyJson());
+}
+
+char*			HandyJson::AllocStr(size_t len) const
+{
+	if (this->p_arena)
+		return (this->p_arena->AllocStr(len));
+	return (new char[len]());
+}
+
+void			HandyJson::TakeNameFromValStr()
+{
+	this->FreeName();
+	this->p_name = this->p_value.str;
+	this->p_flags |= ((this->p_flags & flag_str_ref) ? flag_name_ref : 0) | ((this->p_flags & flag_str_in) ? flag_name_in : 0);
+	memset(&this->p_value.str, 0, sizeof(Str));
+	this->p_flags &= ~(flag_str_ref | flag_str_in);
+}
+
+char*			HandyJson::CopyStr(const char* s, size_t len) const
+{
+	char*		copy;
+
+	if (!(copy = this->AllocStr(len + 1)))
+		return (0);
+	memcpy(copy, s, len);
+	copy[len] = 0;
+	return (copy);
+}
+
+bool			HandyJson::AssignName(const char* s)
+{
+	this->FreeName();
+	return (s && this->StoreStr(this->p_name, flag_name_in, s, strlen(s)));
+}
+
+bool			HandyJson::AssignValStr(const char* s)
+{
+	this->FreeValStr();
+	return (s && this->StoreStr(this->p_value.str, flag_str_in, s, strlen(s)));
+}
+
+/* Put a copy of s in a free Str of the item: inside it if it fits, allocated otherwise */
+bool			HandyJson::StoreStr(Str& str, unsigned char in, const char* s, size_t len)
+{
+	if (len < sizeof(str.in))
+	{
+		memcpy(str.in, s, len);
+		str.in[len] = 0;
+		str.in[15] = (char)(15 - len);
+		this->p_flags |= in;
+		return (true);
+	}
+	this->p_flags &= ~in;
+	if (!(str.out.ptr = this->CopyStr(s, len)))
+		return (false);
+	str.out.len = (unsigned int)len;
+	return (true);
+}
+
+/* The name is referenced, the pool owns it */
+bool			HandyJson::PoolName(HandyJsonKeyPool& pool, const char* s, size_t len)
+{
+	const char*	key;
+
+	if (!(key = pool.Intern(s, len)))
+		return (false);
+	this->p_name.out.ptr = const_cast<char*>(key);
+	this->p_name.out.len = (unsigned int)len;
+	this->p_flags = (this->p_flags & ~flag_name_in) | flag_name_ref | flag_name_pool;
+	return (true);
+}
+
+void			HandyJson::FreeName()
+{
+	if (!(this->p_flags & (flag_name_in | flag_name_ref)) && this->p_name.out.ptr && !this->p_arena)
+		delete[] (this->p_name.out.ptr);
+	memset(&this->p_name, 0, sizeof(Str));
+	this->p_flags &= ~(flag_name_ref | flag_name_in | flag_name_pool);
+}
+
+void			HandyJson::FreeValStr()
+{
+	if (this->p_type != json_string)
+		return;
+	if (!(this->p_flags & (flag_str_in | flag_str_ref)) && this->p_value.str.out.ptr && !this->p_arena)
+		delete[] (this->p_value.str.out.ptr);
+	memset(&this->p_value.str, 0, sizeof(Str));
+	this->p_flags &= ~(flag_str_ref | flag_str_in);
+}
+
+/*
+	+----------------+
+	| Copy functions |
+	+----------------+
+						*/
+/* Same walk as HandyJson::Fire(), each copy being made in the innermost open container */
+bool			HandyJson::CopyFrom(const HandyJson& src, bool recurse)
+{
+	struct	Level
+	{
+		const HandyJson*	from;		// A container of src.
+		HandyJson*			to;			// Its copy.
+	};
+	const HandyJson*	from = &src;
+	HandyJson*			to = this;
+	Level*				stack = 0;
+	Level*				s;
+	size_t				depth = 0, size = 0;
+	bool				ok = true;
+
+	for (;;)
+	{
+		to->p_type = from->p_type;
+		to->p_flags = (to->p_flags & ~(flag_int | flag_uint)) | (from->p_flags & (flag_int | flag_uint));
+		if (from->p_type < json_string)
+			to->p_value = from->p_value;
+		else if (from->GetValStr() && !to->StoreStr(to->p_value.str, flag_str_in, from->GetValStr(), from->GetValStrLen()))
+		{
+			ok = false;
+			break;
+		}
+		if (recurse && from->GetChild())
+		{
+			if (depth == size)
+			{
+				size = size ? size * 2 : 32;
+				if (!(s = new Level[size]))
+				{
+					ok = false;
+					break;
+				}
+				if (depth)
+					memcpy(s, stack, depth * sizeof(Level));
+				delete[] (stack);
+				stack = s;
+			}
+			stack[depth].from = from;
+			stack[depth++].to = to;
+			from = from->GetChild();
+		}
+		else
+		{
+			while (depth && !from->p_next)
+				from = stack[--depth].from;
+			if (!depth)
+				break;
+			from = from->p_next;
+		}
+		if (!(to = stack[depth - 1].to->NewItem()))
+		{
+			ok = false;
+			break;
+		}
+		stack[depth - 1].to->AppendChild(to);
+		if (from->GetName() && !to->StoreStr(to->p_name, flag_name_in, from->GetName(), from->GetNameLen()))
+		{
+			ok = false;
+			break;
+		}
+	}
+	delete[] (stack);
+	return (ok);
+}
+
+/* Only pointers move: both items must live on the heap, or in the same arena */
+void			HandyJson::TakeFrom(HandyJson& src)
+{
+	this->p_type = src.p_type;
+	this->p_value = src.p_value;		// Short strings with it.
+	this->p_size = src.p_size;
+	this->p_flags = (this->p_flags & (flag_name_ref | flag_name_in | flag_name_pool)) | (src.p_flags & (flag_str_ref | flag_str_in | flag_int | flag_uint));
+	src.p_type = json_null;
+	memset(&src.p_value, 0, sizeof(Value));
+	src.p_size = 0;
+	src.p_flags &= flag_name_ref | flag_name_in | flag_name_pool;
+}
+
+void			HandyJson::ClearValue()
+{
+	HandyJson*	c;
+
+	this->IndexDrop();
+	this->ItemsDrop();
+	this->FreeValStr();
+	if ((c = this->GetChild()) && !this->p_arena)
+		delete (c);		// With its following siblings.
+	memset(&this->p_value, 0, sizeof(Value));
+	this->p_size = 0;
+	this->p_type = json_null;
+	this->p_flags &= flag_name_ref | flag_name_in | flag_name_pool;
+}
+
+/* Arrays and objects keep their children through a change, other values are dropped */
+void			HandyJson::SetType(eTypes type)
+{
+	if (type == this->p_type)
+		return;
+	if (type >= json_array && this->p_type >= json_array)
+	{
+		this->IndexDrop();
+		this->ItemsDrop();
+	}
+	else
+		this->ClearValue();
+	this->p_type = type;
+	if (type == json_true)
+		this->p_value.i = 1;		// GetValInt() of a true is 1, as when parsed.
+}
+
+/* Some usefull functions */
+const char*		HandyJson::Skip(const char* in)
+{
+	if (!in || !*in || (unsigned char)*in > 32)
+		return (in);
+	return (HandyJson::sp_skip(in + 1));
+}
+
+const char*		HandyJson::ScanString(const char* in)
+{
+	if (!*in || *in == '\"' || *in == '\\')
+		return (in);
+	return (HandyJson::sp_scan_str(in + 1));
+}
+
+int				HandyJson::StrCaseCmp(const char* s1, const char* s2)
+{
+	if (!s1)
+		return ((s1 == s2) ? 0 : 1);
+	if (!s2)
+		return (1);
+	for	(; tolower(*s1) == tolower(*s2); ++s1, ++s2)
+	{
+		if (*s1 == 0)
+			return (0);
+	}
+	return (tolower(*(const unsigned char *)s1) - tolower(*(const unsigned char *)s2));
+}
+
+char*			HandyJson::StrDup(const char* s)
+{
+	size_t		len;
+    char*		copy;
+
+	if (!s)
+		return (0);
+    len = strlen(s) + 1;
+    if (!(copy = new char[len]()))
+		return (0);
+	memset(copy, 0, len);
+    memcpy(copy, s, len);
+    return (copy);
+}
+
+
+/*
+	+----------------+
+	| Binary formats |
+	+----------------+
+						*/
+/* Read n bytes in network order */
+static inline bool		ReadBigEndian(const char*& ptr, const char* end, int n, uint64_t& v)
+{
+	if (end - ptr < n)
+		return (false);
+	for (v = 0; n > 0; --n)
+		v = (v << 8) | *(const unsigned char*)ptr++;
+	return (true);
+}
+
+char*			HandyJson::PrintMsgPack(size_t& size) const
+{
+	PrintBuffer	pb;
+
+	if (!pb.Init(256))
+		return (0);
+	if (!this->EncodeBinary(pb, false))
+	{
+		delete[] (pb.buf);
+		return (0);
+	}
+	size = pb.len;
+	return (pb.buf);
+}
+
+char*			HandyJson::PrintCbor(size_t& size) const
+{
+	PrintBuffer	pb;
+
+	if (!pb.Init(256))
+		return (0);
+	if (!this->EncodeBinary(pb, true))
+	{
+		delete[] (pb.buf);
+		return (0);
+	}
+	size = pb.len;
+	return (pb.buf);
+}
+
+bool			HandyJson::ParseMsgPack(const void* data, size_t size, size_t* used, HandyJsonError* error)
+{
+	HandyJsonBuilder	builder(*this);
+
+	return (HandyJson::ParseBinary(data, size, builder, false, used, error));
+}
+
+bool			HandyJson::ParseCbor(const void* data, size_t size, size_t* used, HandyJsonError* error)
+{
+	HandyJsonBuilder	builder(*this);
+
+	return (HandyJson::ParseBinary(data, size, builder, true, used, error));
+}
+
+bool			HandyJson::ParseMsgPackSax(const void* data, size_t size, HandyJsonHandler& handler, size_t* used, HandyJsonError* error)
+{
+	return (HandyJson::ParseBinary(data, size, handler, false, used, error));
+}
+
+bool			HandyJson::ParseCborSax(const void* data, size_t size, HandyJsonHandler& handler, size_t* used, HandyJsonError* error)
+{
+	return (HandyJson::ParseBinary(data, size, handler, true, used, error));
+}
+
+/*
+	The whole tree, walked without recursion as CopyFrom() does: containers give
+	their size up front, so nothing is written when one ends.
+*/
+bool			HandyJson::EncodeBinary(PrintBuffer& pb, bool cbor) const
+{
+	const HandyJson*	item = this;
+	const HandyJson**	stack = 0;
+	const HandyJson**	s;
+	size_t				depth = 0, size = 0;
+	bool				ok = true;
+
+	for (;;)
+	{
+		if (depth && stack[depth - 1]->GetType() == json_object)		// The name first, as a string.
+			ok = (cbor ? pb.PutCborHead(3, item->GetNameLen()) : pb.PutMsgPackHead(json_string, item->GetNameLen())) &&
+				pb.Put(item->GetName(), item->GetNameLen());
+		if (!ok || !(cbor ? item->EncodeCbor(pb) : item->EncodeMsgPack(pb)))
+		{
+			ok = false;
+			break;
+		}
+		if (item->GetChild())
+		{
+			if (depth == size)
+			{
+				size = size ? size * 2 : 32;
+				if (!(s = new const HandyJson*[size]))
+				{
+					ok = false;
+					break;
+				}
+				if (depth)
+					memcpy(s, stack, depth * sizeof(HandyJson*));
+				delete[] (stack);
+				stack = s;
+			}
+			stack[depth++] = item;
+			item = item->GetChild();
+			continue;
+		}
+		while (depth && !item->p_next)
+			item = stack[--depth];
+		if (!depth)
+			break;
+		item = item->p_next;
+	}
+	delete[] (stack);
+	return (ok);
+}
+
+/* Smallest encoding of each value: a double goes as a float32 when it holds it exactly */
+bool			HandyJson::EncodeMsgPack(PrintBuffer& pb) const
+{
+	int64_t		i = this->p_value.i;
+	uint64_t	u = (uint64_t)i;
+	uint32_t	u32;
+	float		f;
+
+	switch (this->GetType())
+	{
+		case json_null:		return (pb.Put((char)0xc0));
+		case json_false:	return (pb.Put((char)0xc2));
+		case json_true:		return (pb.Put((char)0xc3));
+		case json_string:
+			return (pb.PutMsgPackHead(json_string, this->GetValStrLen()) && pb.Put(this->GetValStr(), this->GetValStrLen()));
+		case json_number:
+			if (!(this->p_flags & flag_int))
+			{
+				f = fabs(this->p_value.d) <= FLT_MAX ? (float)this->p_value.d : 0;
+				if ((double)f == this->p_value.d)
+				{
+					memcpy(&u32, &f, sizeof(float));
+					return (pb.PutBigEndian(0xca, u32, 4));
+				}
+				memcpy(&u, &this->p_value.d, sizeof(double));
+				return (pb.PutBigEndian(0xcb, u, 8));
+			}
+			if ((this->p_flags & flag_uint) || i >= 0)
+			{
+				if (u < 0x80)			return (pb.PutBigEndian((unsigned char)u, 0, 0));
+				if (u <= 0xff)			return (pb.PutBigEndian(0xcc, u, 1));
+				if (u <= 0xffff)		return (pb.PutBigEndian(0xcd, u, 2));
+				if (u <= 0xffffffff)	return (pb.PutBigEndian(0xce, u, 4));
+				return (pb.PutBigEndian(0xcf, u, 8));
+			}
+			if (i >= -32)				return (pb.PutBigEndian((unsigned char)u, 0, 0));
+			if (i >= INT8_MIN)			return (pb.PutBigEndian(0xd0, u, 1));
+			if (i >= INT16_MIN)			return (pb.PutBigEndian(0xd1, u, 2));
+			if (i >= INT32_MIN)			return (pb.PutBigEndian(0xd2, u, 4));
+			return (pb.PutBigEndian(0xd3, u, 8));
+		default:
+			return (pb.PutMsgPackHead(this->GetType(), this->p_size));		// The children follow, from EncodeBinary().
+	}
+}
+
+bool			HandyJson::EncodeCbor(PrintBuffer& pb) const
+{
+	int64_t		i = this->p_value.i;
+	uint64_t	u;
+	uint32_t	u32;
+	float		f;
+
+	switch (this->GetType())
+	{
+		case json_false:	return (pb.Put((char)0xf4));
+		case json_true:		return (pb.Put((char)0xf5));
+		case json_null:		return (pb.Put((char)0xf6));
+		case json_string:
+			return (pb.PutCborHead(3, this->GetValStrLen()) && pb.Put(this->GetValStr(), this->GetValStrLen()));
+		case json_number:
+			if (!(this->p_flags & flag_int))
+			{
+				f = fabs(this->p_value.d) <= FLT_MAX ? (float)this->p_value.d : 0;
+				if ((double)f == this->p_value.d)
+				{
+					memcpy(&u32, &f, sizeof(float));
+					return (pb.PutBigEndian(0xfa, u32, 4));
+				}
+				memcpy(&u, &this->p_value.d, sizeof(double));
+				return (pb.PutBigEndian(0xfb, u, 8));
+			}
+			if ((this->p_flags & flag_uint) || i >= 0)
+				return (pb.PutCborHead(0, (uint64_t)i));
+			return (pb.PutCborHead(1, ~(uint64_t)i));		// -1 - i
+		default:
+			return (pb.PutCborHead(this->GetType() == json_array ? 4 : 5, this->p_size));
+	}
+}
+
+bool			HandyJson::ParseBinary(const void* data, size_t size, HandyJsonHandler& handler, bool cbor, size_t* used, HandyJsonError* error)
+{
+	BinaryContext	ctx;
+	const char*		end;
+
+	ctx.start = (const char*)data;
+	ctx.where = 0;
+	ctx.code = json_error_none;
+	ctx.handler = &handler;
+	ctx.end = ctx.start + size;
+	ctx.scratch = 0;
+	ctx.size = 0;
+	ctx.stack = 0;
+	ctx.stack_size = 0;
+	ctx.max_depth = HandyJson::sp_max_depth;
+	end = cbor ? HandyJson::DecodeCbor(ctx.start, ctx) : HandyJson::DecodeMsgPack(ctx.start, ctx);
+	delete[] (ctx.scratch);
+	delete[] (ctx.stack);
+	if (end && !used && end != ctx.end)
+		end = HandyJson::Fail(ctx, end, json_error_trailing);
+	if (end && used)
+		*used = end - ctx.start;
+	if (!end && !ctx.where)
+		HandyJson::Fail(ctx, ctx.start, json_error_memory);
+	HandyJson::sp_err = ctx.where;
+	if (error)
+	{
+		error->code = ctx.code;
+		error->offset = end ? 0 : ctx.where - ctx.start;
+		error->line = error->column = 0;
+	}
+	return (end != 0);
+}
+
+/* Open a container of n values (pairs for a map), or of unknown size if open */
+bool			HandyJson::Push(BinaryContext& ctx, const char* at, uint64_t n, bool map, bool open)
+{
+	BinaryContext::Level*	stack;
+
+	if (ctx.depth == ctx.max_depth)
+		return (HandyJson::Fail(ctx, at, json_error_depth) != 0);
+	if (!(map ? ctx.handler->StartObject() : ctx.handler->StartArray()))
+		return (HandyJson::Fail(ctx, at, json_error_handler) != 0);
+	if (!n && !open)
+		return ((map ? ctx.handler->EndObject() : ctx.handler->EndArray()) || HandyJson::Fail(ctx, at, json_error_handler));
+	if (ctx.depth == ctx.stack_size)
+	{
+		ctx.stack_size = ctx.depth ? ctx.depth * 2 : 32;
+		if (!(stack = new BinaryContext::Level[ctx.stack_size]))
+			return (HandyJson::Fail(ctx, at, json_error_memory) != 0);
+		if (ctx.depth)
+			memcpy(stack, ctx.stack, ctx.depth * sizeof(BinaryContext::Level));
+		delete[] (ctx.stack);
+		ctx.stack = stack;
+	}
+	ctx.stack[ctx.depth].left = n;
+	ctx.stack[ctx.depth].map = map;
+	ctx.stack[ctx.depth].key = map;
+	ctx.stack[ctx.depth].open = open;
+	++ctx.depth;
+	return (true);
+}
+
+/* A value just ended: count it in its container, and close the containers it completes */
+bool			HandyJson::Pop(BinaryContext& ctx, const char* at)
+{
+	BinaryContext::Level*	top;
+
+	while (ctx.depth)
+	{
+		top = &ctx.stack[ctx.depth - 1];
+		if (top->open || --top->left)
+		{
+			top->key = top->map;
+			return (true);
+		}
+		if (!(top->map ? ctx.handler->EndObject() : ctx.handler->EndArray()))
+			return (HandyJson::Fail(ctx, at, json_error_handler) != 0);
+		--ctx.depth;
+	}
+	return (true);
+}
+
+/*
+	Iterative, as the text parsers: containers are counted down on ctx.stack. A map
+	alternates keys, which must be strings (or binary), and values.
+*/
+const char*		HandyJson::DecodeMsgPack(const char* ptr, BinaryContext& ctx)
+{
+	BinaryContext::Level*	top;
+	const char*				at;
+	unsigned char			b;
+	uint64_t				v = 0;
+	uint32_t				u32;
+	float					f;
+	double					d;
+	bool					ok;
+
+	ctx.depth = 0;
+	for (;;)
+	{
+		top = ctx.depth ? &ctx.stack[ctx.depth - 1] : 0;
+		if ((at = ptr) == ctx.end)
+			return (HandyJson::Fail(ctx, at, json_error_value));
+		b = *(const unsigned char*)ptr++;
+
+		/* Lengths, and fixed size integers */
+		if ((b >= 0xc4 && b <= 0xc6) || (b >= 0xd9 && b <= 0xdb))
+			ok = ReadBigEndian(ptr, ctx.end, 1 << (b - (b <= 0xc6 ? 0xc4 : 0xd9)), v);
+		else if (b >= 0xca && b <= 0xd3)
+			ok = ReadBigEndian(ptr, ctx.end, b <= 0xcb ? (b - 0xca + 1) * 4 : 1 << ((b - 0xcc) & 3), v);
+		else if (b >= 0xdc && b <= 0xdf)
+			ok = ReadBigEndian(ptr, ctx.end, (b & 1) ? 4 : 2, v);
+		else
+			ok = true;
+		if (!ok)
+			return (HandyJson::Fail(ctx, at, json_error_value));
+		if ((b & 0xe0) == 0xa0)
+			v = b & 0x1f;
+
+		/* Strings and keys */
+		if ((b & 0xe0) == 0xa0 || (b >= 0xc4 && b <= 0xc6) || (b >= 0xd9 && b <= 0xdb))
+		{
+			if ((uint64_t)(ctx.end - ptr) < v)
+				return (HandyJson::Fail(ctx, at, json_error_string));
+			ok = top && top->key ? ctx.handler->Key(ptr, (size_t)v) : ctx.handler->String(ptr, (size_t)v);
+			if (!ok)
+				return (HandyJson::Fail(ctx, at, json_error_handler));
+			ptr += v;
+			if (top && top->key)
+			{
+				top->key = false;
+				continue;
+			}
+		}
+		else if (top && top->key)
+			return (HandyJson::Fail(ctx, at, json_error_key));
+
+		/* Containers */
+		else if ((b >= 0x80 && b <= 0x9f) || (b >= 0xdc && b <= 0xdf))
+		{
+			if (b <= 0x9f)
+				v = b & 0x0f;
+			if (!HandyJson::Push(ctx, at, v, b < 0x90 || b >= 0xde, false))
+				return (0);
+			if (v)
+				continue;
+		}
+
+		/* Scalars */
+		else
+		{
+			switch (b)
+			{
+				case 0xc0:	ok = ctx.handler->Null();			break;
+				case 0xc2:	ok = ctx.handler->Bool(false);		break;
+				case 0xc3:	ok = ctx.handler->Bool(true);		break;
+				case 0xca:
+					u32 = (uint32_t)v;
+					memcpy(&f, &u32, sizeof(float));
+					ok = ctx.handler->Number(f);
+					break;
+				case 0xcb:
+					memcpy(&d, &v, sizeof(double));
+					ok = ctx.handler->Number(d);
+					break;
+				case 0xcc: case 0xcd: case 0xce: case 0xcf:
+					ok = v > (uint64_t)INT64_MAX ? ctx.handler->UInt64(v) : ctx.handler->Int64((int64_t)v);
+					break;
+				case 0xd0:	ok = ctx.handler->Int64((int8_t)v);		break;
+				case 0xd1:	ok = ctx.handler->Int64((int16_t)v);	break;
+				case 0xd2:	ok = ctx.handler->Int64((int32_t)v);	break;
+				case 0xd3:	ok = ctx.handler->Int64((int64_t)v);	break;
+				default:
+					if (b > 0x7f && b < 0xe0)
+						return (HandyJson::Fail(ctx, at, json_error_value));	// Extensions, and 0xc1.
+					ok = ctx.handler->Int64((int8_t)b);
+					break;
+			}
+			if (!ok)
+				return (HandyJson::Fail(ctx, at, json_error_handler));
+		}
+		if (!HandyJson::Pop(ctx, ptr))
+			return (0);
+		if (!ctx.depth)
+			return (ptr);
+	}
+}
+
+/* Half precision float, as CBOR may hold them */
+static inline double	HalfToDouble(uint64_t h)
+{
+	uint64_t	exp = (h >> 10) & 0x1f, mant = h & 0x3ff, bits;
+	double		d;
+
+	if (exp == 0)
+		d = ldexp((double)mant, -24);
+	else if (exp != 31)
+		d = ldexp((double)(mant | 0x400), (int)exp - 25);
+	else
+	{
+		bits = 0x7ff0000000000000ULL | (mant << 42);
+		memcpy(&d, &bits, sizeof(double));
+	}
+	return ((h & 0x8000) ? -d : d);
+}
+
+/*
+	Same walk for CBOR. A container or a string of indefinite length ends with a
+	break byte (0xff), and the chunks of such a string are joined in ctx.scratch.
+*/
+const char*		HandyJson::DecodeCbor(const char* ptr, BinaryContext& ctx)
+{
+	BinaryContext::Level*	top;
+	const char*				at;
+	const char*				str;
+	size_t					len;
+	unsigned char			major, info;
+	uint64_t				v;
+	uint32_t				u32;
+	float					f;
+	double					d;
+	bool					ok;
+
+	ctx.depth = 0;
+	for (;;)
+	{
+		top = ctx.depth ? &ctx.stack[ctx.depth - 1] : 0;
+		if ((at = ptr) == ctx.end)
+			return (HandyJson::Fail(ctx, at, json_error_value));
+		major = *(const unsigned char*)ptr >> 5;
+		info = *(const unsigned char*)ptr++ & 0x1f;
+
+		/* Break of an indefinite container, not between a key and its value */
+		if (major == 7 && info == 31)
+		{
+			if (!top || !top->open || (top->map && !top->key))
+				return (HandyJson::Fail(ctx, at, json_error_value));
+			if (!(top->map ? ctx.handler->EndObject() : ctx.handler->EndArray()))
+				return (HandyJson::Fail(ctx, at, json_error_handler));
+			--ctx.depth;
+			if (!HandyJson::Pop(ctx, ptr))
+				return (0);
+			if (!ctx.depth)
+				return (ptr);
+			continue;
+		}
+
+		/* The argument: a count, a length, an integer or a float */
+		v = info;
+		if (info >= 24 && info <= 27 && !ReadBigEndian(ptr, ctx.end, 1 << (info - 24), v))
+			return (HandyJson::Fail(ctx, at, json_error_value));
+		if ((info > 27 && info < 31) || (info == 31 && (major < 2 || major > 5)))
+			return (HandyJson::Fail(ctx, at, json_error_value));
+		if (major == 6)
+			continue;							// A tag, the item follows.
+
+		/* Strings and keys */
+		if (major == 2 || major == 3)
+		{
+			if (!(ptr = HandyJson::CborString(ptr, at, major, v, info == 31, ctx, str, len)))
+				return (0);
+			ok = top && top->key ? ctx.handler->Key(str, len) : ctx.handler->String(str, len);
+			if (!ok)
+				return (HandyJson::Fail(ctx, at, json_error_handler));
+			if (top && top->key)
+			{
+				top->key = false;
+				continue;
+			}
+		}
+		else if (top && top->key)
+			return (HandyJson::Fail(ctx, at, json_error_key));
+
+		/* Containers */
+		else if (major == 4 || major == 5)
+		{
+			if (!HandyJson::Push(ctx, at, v, major == 5, info == 31))
+				return (0);
+			if (v || info == 31)
+				continue;
+		}
+
+		/* Scalars */
+		else
+		{
+			if (major == 0)
+				ok = v > (uint64_t)INT64_MAX ? ctx.handler->UInt64(v) : ctx.handler->Int64((int64_t)v);
+			else if (major == 1)
+				ok = v > (uint64_t)INT64_MAX ? ctx.handler->Number(-1.0 - (double)v) : ctx.handler->Int64(-1 - (int64_t)v);
+			else if (info == 20 || info == 21)
+				ok = ctx.handler->Bool(info == 21);
+			else if (info == 22 || info == 23)
+				ok = ctx.handler->Null();		// null and undefined.
+			else if (info == 25)
+				ok = ctx.handler->Number(HalfToDouble(v));
+			else if (info == 26)
+			{
+				u32 = (uint32_t)v;
+				memcpy(&f, &u32, sizeof(float));
+				ok = ctx.handler->Number(f);
+			}
+			else if (info == 27)
+			{
+				memcpy(&d, &v, sizeof(double));
+				ok = ctx.handler->Number(d);
+			}
+			else
+				return (HandyJson::Fail(ctx, at, json_error_value));	// Other simple values.
+			if (!ok)
+				return (HandyJson::Fail(ctx, at, json_error_handler));
+		}
+		if (!HandyJson::Pop(ctx, ptr))
+			return (0);
+		if (!ctx.depth)
+			return (ptr);
+	}
+}
+
+/* A string of length v, or the chunks of an open one joined in ctx.scratch */
+const char*		HandyJson::CborString(const char* ptr, const char* at, unsigned char major, uint64_t v, bool open, BinaryContext& ctx, const char*& str, size_t& len)
+{
+	char*		scratch;
+	size_t		size;
+
+	if (!open)
+	{
+		if ((uint64_t)(ctx.end - ptr) < v)
+			return (HandyJson::Fail(ctx, at, json_error_string));
+		str = ptr;
+		len = (size_t)v;
+		return (ptr + len);
+	}
+	for (len = 0; ptr < ctx.end && *(const unsigned char*)ptr != 0xff; ptr += v, len += (size_t)v)
+	{
+		at = ptr;
+		if ((*(const unsigned char*)ptr >> 5) != major || (*(const unsigned char*)ptr & 0x1f) > 27)
+			return (HandyJson::Fail(ctx, at, json_error_string));
+		v = *(const unsigned char*)ptr++ & 0x1f;
+		if ((v >= 24 && !ReadBigEndian(ptr, ctx.end, 1 << (v - 24), v)) || (uint64_t)(ctx.end - ptr) < v)
+			return (HandyJson::Fail(ctx, at, json_error_string));
+		if (!v)
+			continue;
+		if (len + v > ctx.size)
+		{
+			for (size = ctx.size ? ctx.size : 256; size < len + v; size *= 2) ;
+			if (!(scratch = new char[size]))
+				return (HandyJson::Fail(ctx, at, json_error_memory));
+			if (len)
+				memcpy(scratch, ctx.scratch, len);
+			delete[] (ctx.scratch);
+			ctx.scratch = scratch;
+			ctx.size = size;
+		}
+		memcpy(ctx.scratch + len, ptr, (size_t)v);
+	}
+	if (ptr == ctx.end)
+		return (HandyJson::Fail(ctx, ptr, json_error_string));
+	str = len ? ctx.scratch : ptr;
+	return (ptr + 1);
+}
+
+/*
+	+-----------+
+	| Key index |
+	+-----------+
+					*/
+/*
+	Open addressing with linear probing, kept at most half full. Each name is in
+	the table once, pointing to the first child holding it, like a walk of the
+	children would find. Later children with the same name are only counted in
+	dups: removing an indexed child while some exist drops the whole index, as
+	finding the next one would need a walk anyway.
+*/
+struct			HandyJson::KeyIndex
+{
+	struct	Slot
+	{
+		HandyJson*		item;
+		uint32_t		hash;
+	};
+
+	Slot*				slots;
+	size_t				mask;		// Slots count - 1, a power of two.
+	size_t				count;		// Used slots.
+	size_t				dups;		// Children hidden by an earlier one with the same name.
+
+	/* Find the slot of name, or the free slot where it would go */
+	size_t				Find(const char* name, uint32_t hash) const
+	{
+		size_t			i = hash & this->mask;
+
+		while (this->slots[i].item && (this->slots[i].hash != hash || (this->slots[i].item->GetName() != name &&
+			HandyJson::StrCaseCmp(this->slots[i].item->GetName(), name))))
+			i = (i + 1) & this->mask;
+		return (i);
+	}
+};
+
+/* Both indexes of a container share one block, an unused one being zeroed */
+struct			HandyJson::Indexes
+{
+	KeyIndex			keys;
+	ItemIndex			items;
+};
+
+HandyJson::KeyIndex*	HandyJson::Keys() const
+{
+	if (this->p_type < json_array || !this->p_value.kids.indexes || !this->p_value.kids.indexes->keys.slots)
+		return (0);
+	return (&this->p_value.kids.indexes->keys);
+}
+
+HandyJson::ItemIndex*	HandyJson::Items() const
+{
+	if (this->p_type < json_array || !this->p_value.kids.indexes || !this->p_value.kids.indexes->items.items)
+		return (0);
+	return (&this->p_value.kids.indexes->items);
+}
+
+HandyJson::Indexes*		HandyJson::MakeIndexes()
+{
+	Indexes*	idx;
+
+	if (this->p_value.kids.indexes)
+		return (this->p_value.kids.indexes);
+	if (this->p_arena)
+		idx = (Indexes*)this->p_arena->Alloc(sizeof(Indexes));
+	else
+		idx = new Indexes;
+	if (idx)
+		memset(idx, 0, sizeof(Indexes));
+	return (this->p_value.kids.indexes = idx);
+}
+
+void			HandyJson::FreeIndexes()
+{
+	Indexes*	idx = this->p_value.kids.indexes;
+
+	if (!idx || idx->keys.slots || idx->items.items)
+		return;
+	if (!this->p_arena)
+		delete (idx);
+	this->p_value.kids.indexes = 0;
+}
+
+/* Up to len bytes, and never past a zero, where StrCaseCmp() stops too */
+uint32_t		HandyJson::HashName(const char* name, size_t len)
+{
+	uint32_t	h = 2166136261u;		// FNV-1a, on lower case characters as StrCaseCmp() compares them.
+
+	for (; len && *name; ++name, --len)
+		h = (h ^ (uint32_t)tolower(*(const unsigned char*)name)) * 16777619u;
+	return (h);
+}
+
+uint32_t		HandyJson::NameHash() const
+{
+	if (this->p_flags & flag_name_pool)
+		return (HandyJsonKeyPool::GetHash(this->p_name.out.ptr));
+	return (this->HashName(this->GetName()));
+}
+
+HandyJson*		HandyJson::IndexFind(const char* name, uint32_t hash) const
+{
+	const KeyIndex*	idx = &this->p_value.kids.indexes->keys;
+
+	return (idx->slots[idx->Find(name, hash)].item);
+}
+
+/* The child named string, through the index if there is one, counting the children walked otherwise */
+HandyJson*		HandyJson::WalkItem(const char* string, int& walked) const
+{
+	HandyJson*	c = this->GetChild();
+
+	walked = 0;
+	if (string && this->Keys())
+		return (this->IndexFind(string, this->HashName(string)));
+	while (c && c->GetName() != string && this->StrCaseCmp(c->GetName(), string))		// Pooled names match by pointer.
+	{
+		c = c->GetNext();
+		++walked;
+	}
+	return (c);
+}
+
+/*
+	Every container of the tree with HANDYJSON_INDEX_MIN children or more, this one
+	included, gets its indexes: the names of an object, the positions of an array.
+	Walked without recursion, as CopyFrom() does.
+*/
+void			HandyJson::BuildIndexes()
+{
+	HandyJson*	item = this;
+	HandyJson**	stack = 0;
+	HandyJson**	s;
+	size_t		depth = 0, size = 0;
+
+	for (;;)
+	{
+		if (item->GetType() == json_object && item->p_size >= HANDYJSON_INDEX_MIN && !item->Keys())
+			item->IndexBuild();
+		if (item->GetType() == json_array && item->p_size > HANDYJSON_INDEX_MIN && !item->Items())
+			item->ItemsBuild();
+		if (item->GetChild())
+		{
+			if (depth == size)
+			{
+				size = size ? size * 2 : 32;
+				if (!(s = new HandyJson*[size]))
+					break;
+				if (depth)
+					memcpy(s, stack, depth * sizeof(HandyJson*));
+				delete[] (stack);
+				stack = s;
+			}
+			stack[depth++] = item;
+			item = item->GetChild();
+			continue;
+		}
+		while (depth && !item->p_next)
+			item = stack[--depth];
+		if (!depth)
+			break;
+		item = item->p_next;
+	}
+	delete[] (stack);
+}
+
+/* GetObjectItem(), for a caller which hashed the name beforehand */
+HandyJson*		HandyJson::FindItem(const char* name, uint32_t hash) const
+{
+	if (this->Keys())
+		return (this->IndexFind(name, hash));
+	return (this->GetObjectItem(name));
+}
+
+void			HandyJson::IndexBuild()
+{
+	Indexes*	both;
+	KeyIndex*	idx;
+	size_t		cap = 16;
+	HandyJson*	c;
+
+	while (cap < this->p_size * 2)
+		cap *= 2;
+	if (!(both = this->MakeIndexes()))
+		return;
+	idx = &both->keys;
+	if (this->p_arena)
+		idx->slots = (KeyIndex::Slot*)this->p_arena->Alloc(cap * sizeof(KeyIndex::Slot));
+	else
+		idx->slots = new KeyIndex::Slot[cap];
+	if (!idx->slots)
+	{
+		this->FreeIndexes();
+		return;
+	}
+	memset(idx->slots, 0, cap * sizeof(KeyIndex::Slot));
+	idx->mask = cap - 1;
+	idx->count = 0;
+	idx->dups = 0;
+	for (c = this->GetChild(); c; c = c->GetNext())
+		this->IndexAdd(c, true);
+}
+
+void			HandyJson::IndexAdd(HandyJson* item, bool last)
+{
+	KeyIndex*	idx = this->Keys();
+	uint32_t	hash;
+	size_t		i;
+
+	if (!item->GetName())
+		return;
+	if ((idx->count + 1) * 2 > idx->mask + 1)
+	{
+		this->IndexDrop();		// Built again, twice as big, by the next slow lookup.
+		return;
+	}
+	hash = item->NameHash();
+	i = idx->Find(item->GetName(), hash);
+	if (idx->slots[i].item)
+	{
+		if (last)
+			++idx->dups;		// The indexed child comes first and stays.
+		else
+			this->IndexDrop();	// Inserted somewhere in the middle, do not guess.
+		return;
+	}
+	idx->slots[i].item = item;
+	idx->slots[i].hash = hash;
+	++idx->count;
+}
+
+void			HandyJson::IndexRemove(HandyJson* item)
+{
+	KeyIndex*	idx = this->Keys();
+	size_t		i, j, home;
+
+	if (!item->GetName())
+		return;
+	i = idx->Find(item->GetName(), item->NameHash());
+	if (idx->slots[i].item != item)
+	{
+		if (idx->dups)
+			--idx->dups;		// A hidden child goes away.
+		return;
+	}
+	if (idx->dups)
+	{
+		this->IndexDrop();
+		return;
+	}
+	for (j = (i + 1) & idx->mask; idx->slots[j].item; j = (j + 1) & idx->mask)
+	{
+		home = idx->slots[j].hash & idx->mask;
+		if (((j - home) & idx->mask) >= ((j - i) & idx->mask))
+		{
+			idx->slots[i] = idx->slots[j];		// Shift back entries which would not be found past the hole.
+			i = j;
+		}
+	}
+	idx->slots[i].item = 0;
+	--idx->count;
+}
+
+void			HandyJson::IndexDrop()
+{
+	KeyIndex*	idx = this->Keys();
+
+	if (!idx)
+		return;
+	if (!this->p_arena)
+		delete[] (idx->slots);
+	memset(idx, 0, sizeof(KeyIndex));
+	this->FreeIndexes();
+}
+
+/*
+	+------------+
+	| Item index |
+	+------------+
+					*/
+/*
+	The children in order, for GetArrayItem(). Appends are amortized O(1) and
+	removals move the following pointers down, replacing only swaps a pointer.
+*/
+void			HandyJson::ItemsBuild()
+{
+	Indexes*	both;
+	ItemIndex*	idx;
+	HandyJson**	items;
+	HandyJson*	c;
+	size_t		cap = 16;
+
+	while (cap < this->p_size)
+		cap *= 2;
+	if (!(both = this->MakeIndexes()))
+		return;
+	idx = &both->items;
+	if (this->p_arena)
+		idx->items = (HandyJson**)this->p_arena->Alloc(cap * sizeof(HandyJson*));
+	else
+		idx->items = new HandyJson*[cap];
+	if (!idx->items)
+	{
+		this->FreeIndexes();
+		return;
+	}
+	idx->cap = cap;
+	items = idx->items;
+	for (c = this->GetChild(); c; c = c->GetNext())
+		*items++ = c;
+}
+
+void			HandyJson::ItemsPush(HandyJson* item)
+{
+	ItemIndex*	idx = this->Items();
+	HandyJson**	items;
+	size_t		cap;
+
+	if (this->p_size > idx->cap)		// p_size already counts item.
+	{
+		cap = idx->cap * 2;
+		if (this->p_arena)
+			items = (HandyJson**)this->p_arena->Alloc(cap * sizeof(HandyJson*));
+		else
+			items = new HandyJson*[cap];
+		if (!items)
+		{
+			this->ItemsDrop();
+			return;
+		}
+		memcpy(items, idx->items, idx->cap * sizeof(HandyJson*));
+		if (!this->p_arena)
+			delete[] (idx->items);
+		idx->items = items;
+		idx->cap = cap;
+	}
+	idx->items[this->p_size - 1] = item;
+}
+
+void			HandyJson::ItemsRemove(HandyJson* item, int pos)
+{
+	HandyJson**	items = this->Items()->items;
+
+	if (pos < 0)
+		for (pos = 0; items[pos] != item; ++pos) ;
+	memmove(items + pos, items + pos + 1, (this->p_size - pos - 1) * sizeof(HandyJson*));
+}
+
+void			HandyJson::ItemsDrop()
+{
+	ItemIndex*	idx = this->Items();
+
+	if (!idx)
+		return;
+	if (!this->p_arena)
+		delete[] (idx->items);
+	memset(idx, 0, sizeof(ItemIndex));
+	this->FreeIndexes();
+}
+
+/*
+	+----------------+
+	| HandyJsonArena |
+	+----------------+
+						*/
+HandyJsonArena::HandyJsonArena(size_t block_size) :
+	p_blocks(0), p_ptr(0), p_end(0), p_block_size(block_size)
+{
+	if (this->p_block_size < 1024)
+		this->p_block_size = 1024;
+}
+
+HandyJsonArena::~HandyJsonArena(void)
+{
+	this->Release();
+}
+
+bool			HandyJsonArena::Grow(size_t need)
+{
+	Block*		b;
+	size_t		size = this->p_block_size;
+
+	if (need + sizeof(Block) + 16 > size)
+		size = need + sizeof(Block) + 16;
+	b = (Block*)malloc(size);
+	if (!b)
+		return (false);
+	b->size = size;
+	b->next = this->p_blocks;
+	this->p_blocks = b;
+	this->p_ptr = (char*)b + sizeof(Block);
+	this->p_end = (char*)b + size;
+	return (true);
+}
+
+void*			HandyJsonArena::Alloc(size_t size, size_t align)
+{
+	size_t		pad = (align - ((size_t)this->p_ptr & (align - 1))) & (align - 1);
+
+	if (!this->p_ptr || (size_t)(this->p_end - this->p_ptr) < size + pad)
+	{
+		if (!this->Grow(size + align))
+			return (0);
+		pad = (align - ((size_t)this->p_ptr & (align - 1))) & (align - 1);
+	}
+	this->p_ptr += pad;
+	void*		out = this->p_ptr;
+	this->p_ptr += size;
+	return (out);
+}
+
+char*			HandyJsonArena::AllocStr(size_t len)
+{
+	char*		out = (char*)this->Alloc(len, 1);
+
+	if (out && len)
+		*out = 0;
+	return (out);
+}
+
+char*			HandyJsonArena::StrDup(const char* s)
+{
+	size_t		len;
+	char*		copy;
+
+	if (!s)
+		return (0);
+	len = strlen(s) + 1;
+	if (!(copy = this->AllocStr(len)))
+		return (0);
+	memcpy(copy, s, len);
+	return (copy);
+}
+
+HandyJson*		HandyJsonArena::NewItem()
+{
+	void*		mem = this->Alloc(sizeof(HandyJson));
+
+	if (!mem)
+		return (0);
+	return (new (mem) HandyJson(this));
+}
+
+/* Like Release(), but the largest block is kept and reused by the next items */
+void			HandyJsonArena::Reset()
+{
+	Block*		keep = this->p_blocks;
+	Block*		b;
+
+	for (b = this->p_blocks; b; b = b->next)
+	{
+		if (b->size > keep->size)
+			keep = b;
+	}
+	while (this->p_blocks)
+	{
+		b = this->p_blocks;
+		this->p_blocks = b->next;
+		if (b != keep)
+			free(b);
+	}
+	if (!keep)
+		return;
+	keep->next = 0;
+	this->p_blocks = keep;
+	this->p_ptr = (char*)keep + sizeof(Block);
+	this->p_end = (char*)keep + keep->size;
+}
+
+void			HandyJsonArena::Release()
+{
+	Block*		b;
+
+	while (this->p_blocks)
+	{
+		b = this->p_blocks;
+		this->p_blocks = b->next;
+		free(b);
+	}
+	this->p_ptr = this->p_end = 0;
+}
+
+/*
+	+------------------+
+	| HandyJsonKeyPool |
+	+------------------+
+						*/
+HandyJsonKeyPool::HandyJsonKeyPool(void) :
+	p_strings(4096), p_slots(0), p_mask(0), p_count(0)
+{
+}
+
+HandyJsonKeyPool::~HandyJsonKeyPool(void)
+{
+	delete[] (this->p_slots);
+}
+
+/* Eight bytes at a time: the pool compares exact bytes, the slower case blind hash is made once per name */
+uint32_t		HandyJsonKeyPool::Hash(const char* name, size_t len)
+{
+	uint64_t	h = 0x9e3779b97f4a7c15ULL ^ len;
+	uint64_t	w;
+
+	for (; len >= 8; name += 8, len -= 8)
+	{
+		memcpy(&w, name, 8);
+		h = (h ^ w) * 0xff51afd7ed558ccdULL;
+		h ^= h >> 32;
+	}
+	w = 0;
+	memcpy(&w, name, len);
+	h = (h ^ w) * 0xff51afd7ed558ccdULL;
+	return ((uint32_t)(h ^ (h >> 29)));
+}
+
+/* Each name is kept after its key index hash, which items read back through GetHash() */
+const char*		HandyJsonKeyPool::Intern(const char* name, size_t len)
+{
+	uint32_t	hash = HandyJsonKeyPool::Hash(name, len);
+	size_t		i;
+	char*		key;
+
+	if ((this->p_count + 1) * 2 > this->p_mask + 1 && !this->Grow())
+		return (0);
+	for (i = hash & this->p_mask; this->p_slots[i].key; i = (i + 1) & this->p_mask)
+	{
+		if (this->p_slots[i].hash == hash && this->p_slots[i].len == len && !memcmp(this->p_slots[i].key, name, len))
+			return (this->p_slots[i].key);
+	}
+	if (len > UINT_MAX || !(key = (char*)this->p_strings.Alloc(sizeof(uint32_t) + len + 1, sizeof(uint32_t))))
+		return (0);
+	*(uint32_t*)key = HandyJson::HashName(name, len);
+	key += sizeof(uint32_t);
+	memcpy(key, name, len);
+	key[len] = 0;
+	this->p_slots[i].key = key;
+	this->p_slots[i].hash = hash;
+	this->p_slots[i].len = (uint32_t)len;
+	++this->p_count;
+	return (key);
+}
+
+const char*		HandyJsonKeyPool::Intern(const char* name)
+{
+	return (name ? this->Intern(name, strlen(name)) : 0);
+}
+
+/* The table and a block are kept for the next names */
+void			HandyJsonKeyPool::Clear()
+{
+	if (this->p_slots)
+		memset(this->p_slots, 0, (this->p_mask + 1) * sizeof(Slot));
+	this->p_count = 0;
+	this->p_strings.Reset();
+}
+
+bool			HandyJsonKeyPool::Grow()
+{
+	size_t		size = this->p_slots ? (this->p_mask + 1) * 2 : 64;
+	Slot*		slots;
+	size_t		i, j;
+
+	if (!(slots = new Slot[size]))
+		return (false);
+	memset(slots, 0, size * sizeof(Slot));
+	for (i = 0; this->p_slots && i <= this->p_mask; ++i)
+	{
+		if (!this->p_slots[i].key)
+			continue;
+		for (j = this->p_slots[i].hash & (size - 1); slots[j].key; j = (j + 1) & (size - 1)) ;
+		slots[j] = this->p_slots[i];
+	}
+	delete[] (this->p_slots);
+	this->p_slots = slots;
+	this->p_mask = size - 1;
+	return (true);
+}
+
+/*
+	+---------------+
+	| HandyJsonFile |
+	+---------------+
+						*/
+HandyJsonFile::HandyJsonFile(void) :
+	p_data(0), p_size(0), p_map_size(0)
+{
+}
+
+HandyJsonFile::~HandyJsonFile(void)
+{
+	this->Close();
+}
+
+bool			HandyJsonFile::Open(const char* path, bool writable)
+{
+	this->Close();
+	if (!path)
+		return (false);
+	return (this->Map(path, writable) || this->Read(path));
+}
+
+void			HandyJsonFile::Close()
+{
+	if (this->p_data && this->p_map_size)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(this->p_data);
+#elif defined(HANDYJSON_MMAP)
+		munmap(this->p_data, this->p_map_size);
+#endif
+	}
+	else
+		delete[] (this->p_data);
+	this->p_data = 0;
+	this->p_size = 0;
+	this->p_map_size = 0;
+}
+
+/*
+	The data must be followed by a zero. On POSIX, the file is always mapped over
+	a reserved anonymous area at least one page longer, which reads as zeros.
+	Windows can not map over a reservation: there the zero only comes for free
+	when the size is not a multiple of the page size, the end of the last page
+	reading as zeros, and the other files are read instead.
+*/
+bool			HandyJsonFile::Map(const char* path, bool writable)
+{
+#if defined(_WIN32)
+	HANDLE			file, mapping;
+	LARGE_INTEGER	size;
+	SYSTEM_INFO		info;
+	void*			view;
+
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return (false);
+	GetSystemInfo(&info);
+	if (!GetFileSizeEx(file, &size) || !size.QuadPart || !(size.QuadPart % info.dwPageSize) ||
+		(unsigned long long)size.QuadPart >= (size_t)-1)
+	{
+		CloseHandle(file);
+		return (false);
+	}
+	mapping = CreateFileMappingA(file, 0, writable ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, 0);
+	view = mapping ? MapViewOfFile(mapping, writable ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0) : 0;
+	if (mapping)
+		CloseHandle(mapping);
+	CloseHandle(file);
+	if (!view)
+		return (false);
+	this->p_data = (char*)view;
+	this->p_size = (size_t)size.QuadPart;
+	this->p_map_size = this->p_size;
+	return (true);
+#elif defined(HANDYJSON_MMAP)
+	struct stat		st;
+	size_t			page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t			size, map_size;
+	int				fd, prot = PROT_READ | (writable ? PROT_WRITE : 0);
+	void*			base;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return (false);
+	if (fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0 || (unsigned long long)st.st_size >= (size_t)-1 - page)
+	{
+		close(fd);
+		return (false);
+	}
+	size = (size_t)st.st_size;
+	map_size = (size / page + 1) * page;		// Room for the zero, always.
+	base = mmap(0, map_size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base != MAP_FAILED && mmap(base, size, prot, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		munmap(base, map_size);
+		base = MAP_FAILED;
+	}
+	close(fd);
+	if (base == MAP_FAILED)
+		return (false);
+	madvise(base, size, MADV_SEQUENTIAL);
+	madvise(base, size, MADV_WILLNEED);
+	this->p_data = (char*)base;
+	this->p_size = size;
+	this->p_map_size = map_size;
+	return (true);
+#else
+	(void)path;
+	(void)writable;
+	return (false);
+#endif
+}
+
+/* Fallback for what can not be mapped, the size is not trusted. */
+bool			HandyJsonFile::Read(const char* path)
+{
+	FILE*		file = fopen(path, "rb");
+	char*		buf;
+	size_t		cap = 64 * 1024, len = 0, n;
+
+	if (!file)
+		return (false);
+	if (!(this->p_data = new char[cap]))
+	{
+		fclose(file);
+		return (false);
+	}
+	while ((n = fread(this->p_data + len, 1, cap - len - 1, file)) > 0)
+	{
+		len += n;
+		if (cap - len > 1)
+			continue;
+		if (!(buf = new char[cap * 2]))
+			break;
+		memcpy(buf, this->p_data, len);
+		delete[] (this->p_data);
+		this->p_data = buf;
+		cap *= 2;
+	}
+	if (ferror(file) || n)
+	{
+		fclose(file);
+		this->Close();
+		return (false);
+	}
+	fclose(file);
+	this->p_data[len] = 0;
+	this->p_size = len;
+	return (true);
+}
+
+/*
+	+---------------+
+	| HandyJsonPush |
+	+---------------+
+						*/
+HandyJsonPush::HandyJsonPush(HandyJsonHandler& handler) :
+	p_handler(&handler), p_literal(0), p_buf(0), p_buf_len(0), p_buf_size(0), p_stack(0), p_depth(0), p_stack_size(0),
+	p_chunk(0), p_offset(0), p_line(1), p_line_offset(0), p_token_offset(0), p_token_line(0), p_token_column(0)
+{
+	this->Reset();
+}
+
+HandyJsonPush::~HandyJsonPush(void)
+{
+	delete[] (this->p_buf);
+	delete[] (this->p_stack);
+}
+
+void			HandyJsonPush::Reset()
+{
+	this->p_expect = expect_value;
+	this->p_token = token_none;
+	this->p_buf_len = 0;
+	this->p_depth = 0;
+	this->p_error.code = json_error_none;
+	this->p_error.offset = 0;
+	this->p_error.line = this->p_error.column = 0;
+}
+
+size_t			HandyJsonPush::Feed(const char* data, size_t size)
+{
+	const char*	ptr = data;
+	const char*	end = data + size;
+
+	if (this->p_expect == expect_nothing)
+		return (0);
+	this->p_chunk = data;
+	if (this->p_token != token_none)
+		ptr = this->Token(ptr, end, 0);		// Finish the token of the previous chunk.
+	while (ptr && ptr < end && this->p_expect != expect_nothing)
+	{
+		ptr = this->Skip(ptr, end);
+		if (ptr < end)
+			ptr = this->Step(ptr, end);
+	}
+	if (ptr)
+		size = ptr - data;
+	this->p_offset += size;
+	return (size);
+}
+
+bool			HandyJsonPush::Finish()
+{
+	size_t		used;
+
+	if (this->p_expect == expect_nothing)
+		return (this->IsDone());
+	if (this->p_token == token_number)
+	{
+		/* Nothing follows the number, it is complete */
+		if (!this->Keep("", 1))
+			return (this->Fail(this->p_offset, json_error_memory), false);
+		if (!this->EndNumber(this->p_buf, used))
+			return (false);
+		if (used < this->p_buf_len - 1)
+			return (this->Fail(this->p_token_offset + used, this->AfterValueError()), false);
+		if (this->p_expect == expect_nothing)
+			return (true);
+	}
+	if (this->p_token == token_key || this->p_token == token_string)
+		this->Fail(this->p_token_offset, json_error_string);
+	else if (this->p_token != token_none)
+		this->Fail(this->p_token_offset, json_error_value);
+	else if (this->p_expect == expect_colon)
+		this->Fail(this->p_offset, json_error_colon);
+	else if (this->p_expect == expect_comma_or_close)
+		this->Fail(this->p_offset, this->AfterValueError());
+	else if (this->p_expect == expect_key || this->p_expect == expect_key_or_close)
+		this->Fail(this->p_offset, json_error_key);
+	else
+		this->Fail(this->p_offset, json_error_value);
+	return (false);
+}
+
+const char*		HandyJsonPush::Skip(const char* ptr, const char* end)
+{
+	while (ptr < end && *ptr && (unsigned char)*ptr <= 32)
+	{
+		if (*ptr == '\n')
+		{
+			++this->p_line;
+			this->p_line_offset = this->Pos(ptr) + 1;
+		}
+		++ptr;
+	}
+	return (ptr);
+}
+
+/* Same grammar as HandyJson::SaxValue(), one byte or one token at a time */
+const char*		HandyJsonPush::Step(const char* ptr, const char* end)
+{
+	switch (this->p_expect)
+	{
+		case expect_colon:
+			if (*ptr != ':') { return (this->Fail(this->Pos(ptr), json_error_colon)); }
+			this->p_expect = expect_value;
+			return (ptr + 1);
+		case expect_comma_or_close:
+			if (*ptr != ',')
+				return (this->Close(ptr));
+			this->p_expect = this->p_stack[this->p_depth - 1] == '[' ? expect_value : expect_key;
+			return (ptr + 1);
+		case expect_key_or_close:
+			if (*ptr == '}')
+				return (this->Close(ptr));
+			/* Fall through */
+		case expect_key:
+			if (*ptr != '\"') { return (this->Fail(this->Pos(ptr), json_error_key)); }
+			this->p_token = token_key;
+			break;
+		case expect_value_or_close:
+			if (*ptr == ']')
+				return (this->Close(ptr));
+			/* Fall through */
+		default:
+			if (*ptr == '[' || *ptr == '{')
+				return (this->Open(ptr));
+			if (*ptr == '\"')
+				this->p_token = token_string;
+			else if (*ptr == '-' || (*ptr >= '0' && *ptr <= '9'))
+				this->p_token = token_number;
+			else if (*ptr == 't')
+				this->p_token = token_true;
+			else if (*ptr == 'f')
+				this->p_token = token_false;
+			else if (*ptr == 'n')
+				this->p_token = token_null;
+			else
+				return (this->Fail(this->Pos(ptr), json_error_value));
+			break;
+	}
+
+	/* A token begins */
+	this->p_token_offset = this->Pos(ptr);
+	this->p_token_line = this->p_line;
+	this->p_token_column = this->p_token_offset - this->p_line_offset + 1;
+	this->p_escape = 0;
+	this->p_escaped = false;
+	this->p_literal = this->p_token == token_true ? "true" : this->p_token == token_false ? "false" : "null";
+	this->p_buf_len = 0;
+	return (this->Token(*ptr == '\"' ? ptr + 1 : ptr, end, ptr));
+}
+
+/*
+	Read a token up to its end, begin being its first byte in this chunk, or null if
+	it began in a previous chunk and is in p_buf. A token cut by the end of the chunk
+	is kept in p_buf, otherwise it is used in place unless it needs decoding.
+*/
+const char*		HandyJsonPush::Token(const char* ptr, const char* end, const char* begin)
+{
+	const char*	from = begin ? begin : ptr;		// Bytes of the token in this chunk.
+	const char*	q;
+	size_t		used;
+
+	if (this->p_token == token_key || this->p_token == token_string)
+	{
+		if (!this->p_escape && (q = (const char*)memchr(ptr, '\"', end - ptr)) && !memchr(ptr, '\\', q - ptr) && !memchr(ptr, '\n', q - ptr))
+			ptr = q;		// Plain string, the quote is the end.
+		for (q = ptr; q < end; ++q)
+		{
+			if (this->p_escape == 5)
+				this->p_escape = *q == 'u' ? 4 : 0;		// \u takes four more bytes, whatever they are.
+			else if (this->p_escape)
+				--this->p_escape;
+			else if (*q == '\"')
+				break;
+			else if (*q == '\\')
+			{
+				this->p_escape = 5;
+				this->p_escaped = true;
+			}
+			if (*q == '\n')
+			{
+				++this->p_line;
+				this->p_line_offset = this->Pos(q) + 1;
+			}
+		}
+		if (q == end)
+			return (this->Keep(from, end - from) ? end : 0);
+		if (begin && !this->p_escaped)
+			return (this->EndString(begin + 1, q - begin - 1) ? q + 1 : 0);
+		if (!this->Keep(from, q + 1 - from) || !this->Keep("", 1))
+			return (0);
+		return (this->EndString(this->p_buf + 1, this->p_buf_len - 3) ? q + 1 : 0);
+	}
+
+	if (this->p_token != token_number)
+	{
+		/* Literals are matched as they come, nothing to keep */
+		for (q = ptr; q < end && *this->p_literal; ++q, ++this->p_literal)
+			if (*q != *this->p_literal)
+				return (this->Fail(this->p_token_offset, json_error_value));
+		if (*this->p_literal)
+			return (end);
+		return (this->EndLiteral() ? q : 0);
+	}
+
+	for (q = ptr; q < end && ((*q >= '0' && *q <= '9') || *q == '-' || *q == '+' || *q == '.' || *q == 'e' || *q == 'E'); ++q) ;
+	if (q == end)
+		return (this->Keep(from, end - from) ? end : 0);
+	if (begin)
+		return (this->EndNumber(begin, used) ? begin + used : 0);	// What follows is read as in a one piece parse.
+	if (!this->Keep(from, q - from) || !this->Keep("", 1))
+		return (0);
+	if (!this->EndNumber(this->p_buf, used))
+		return (0);
+	if (used < this->p_buf_len - 1)
+		return (this->Fail(this->p_token_offset + used, this->AfterValueError()));
+	return (q);
+}
+
+/* A whole string, or name, between its quotes */
+bool			HandyJsonPush::EndString(const char* str, size_t len)
+{
+	const char*	ptr;
+	char*		ptr2;
+	bool		ok;
+
+	if (this->p_escaped)
+	{
+		/* In p_buf, followed by the closing quote and a zero: decode it in place */
+		ptr2 = (char*)str;
+		ptr = HandyJson::DecodeString(str, ptr2);
+		if (ptr != str + len)
+			return (this->Fail(this->p_token_offset, json_error_string), false);
+		len = ptr2 - str;
+	}
+	ok = this->p_token == token_key ? this->p_handler->Key(str, len) : this->p_handler->String(str, len);
+	if (!ok)
+		return (this->Fail(this->p_token_offset, json_error_handler), false);
+	if (this->p_token == token_key)
+		this->p_expect = expect_colon;
+	else
+		this->AfterValue(0);
+	this->p_token = token_none;
+	return (true);
+}
+
+/*
+	A number, followed by a byte which can not be part of it: HandyJson::ScanNumber()
+	reads it, used tells how much of it as some sequences like "1." stop early.
+*/
+bool			HandyJsonPush::EndNumber(const char* str, size_t& used)
+{
+	HandyJson::NumberValue	n;
+	bool					ok;
+
+	used = HandyJson::ScanNumber(str, n) - str;
+	if (!n.is_int)			ok = this->p_handler->Number(n.dbl);
+	else if (n.is_uint)		ok = this->p_handler->UInt64(n.bits);
+	else					ok = this->p_handler->Int64((int64_t)n.bits);
+	if (!ok) { return (this->Fail(this->p_token_offset, json_error_handler), false); }
+	this->p_token = token_none;
+	this->AfterValue(0);
+	return (true);
+}
+
+bool			HandyJsonPush::EndLiteral()
+{
+	bool		ok;
+
+	if (this->p_token == token_null)	ok = this->p_handler->Null();
+	else								ok = this->p_handler->Bool(this->p_token == token_true);
+	if (!ok) { return (this->Fail(this->p_token_offset, json_error_handler), false); }
+	this->p_token = token_none;
+	this->AfterValue(0);
+	return (true);
+}
+
+const char*		HandyJsonPush::Open(const char* ptr)
+{
+	char*		stack;
+
+	if (this->p_depth == HandyJson::GetMaxDepth()) { return (this->Fail(this->Pos(ptr), json_error_depth)); }
+	if (!(*ptr == '[' ? this->p_handler->StartArray() : this->p_handler->StartObject())) { return (this->Fail(this->Pos(ptr), json_error_handler)); }
+	if (this->p_depth == this->p_stack_size)
+	{
+		this->p_stack_size = this->p_depth ? this->p_depth * 2 : 32;
+		if (!(stack = new char[this->p_stack_size]))
+			return (this->Fail(this->Pos(ptr), json_error_memory));
+		if (this->p_depth)
+			memcpy(stack, this->p_stack, this->p_depth);
+		delete[] (this->p_stack);
+		this->p_stack = stack;
+	}
+	this->p_stack[this->p_depth++] = *ptr;
+	this->p_expect = *ptr == '[' ? expect_value_or_close : expect_key_or_close;
+	return (ptr + 1);
+}
+
+const char*		HandyJsonPush::Close(const char* ptr)
+{
+	bool		array = this->p_stack[this->p_depth - 1] == '[';
+
+	if (*ptr != (array ? ']' : '}')) { return (this->Fail(this->Pos(ptr), array ? json_error_array : json_error_object)); }
+	if (!(array ? this->p_handler->EndArray() : this->p_handler->EndObject())) { return (this->Fail(this->Pos(ptr), json_error_handler)); }
+	--this->p_depth;
+	return (this->AfterValue(ptr + 1));
+}
+
+const char*		HandyJsonPush::AfterValue(const char* ptr)
+{
+	this->p_expect = this->p_depth ? expect_comma_or_close : expect_nothing;
+	return (ptr);
+}
+
+eErrors			HandyJsonPush::AfterValueError() const
+{
+	if (!this->p_depth)
+		return (json_error_trailing);
+	return (this->p_stack[this->p_depth - 1] == '[' ? json_error_array : json_error_object);
+}
+
+bool			HandyJsonPush::Keep(const char* data, size_t len)
+{
+	char*		buf;
+	size_t		size;
+
+	if (this->p_buf_len + len > this->p_buf_size)
+	{
+		size = this->p_buf_size ? this->p_buf_size * 2 : 256;
+		if (size < this->p_buf_len + len)
+			size = this->p_buf_len + len;
+		if (!(buf = new char[size]))
+			return (this->Fail(this->p_token_offset, json_error_memory), false);
+		if (this->p_buf_len)
+			memcpy(buf, this->p_buf, this->p_buf_len);
+		delete[] (this->p_buf);
+		this->p_buf = buf;
+		this->p_buf_size = size;
+	}
+	memcpy(this->p_buf + this->p_buf_len, data, len);
+	this->p_buf_len += len;
+	return (true);
+}
+
+/* Failures are reported on the line of the token when it spans an end of line */
+const char*		HandyJsonPush::Fail(size_t offset, eErrors code)
+{
+	this->p_error.code = code;
+	this->p_error.offset = offset;
+	if (offset >= this->p_line_offset)
+	{
+		this->p_error.line = this->p_line;
+		this->p_error.column = offset - this->p_line_offset + 1;
+	}
+	else
+	{
+		this->p_error.line = this->p_token_line;
+		this->p_error.column = this->p_token_column + (offset - this->p_token_offset);
+	}
+	this->p_expect = expect_nothing;
+	this->p_token = token_none;
+	return (0);
+}
+
+/*
+	+------------------+
+	| HandyJsonBuilder |
+	+------------------+
+						*/
+HandyJsonBuilder::HandyJsonBuilder(HandyJson& root, HandyJsonKeyPool* keys) :
+	p_root(&root), p_stack(0), p_depth(0), p_stack_size(0), p_item(0), p_started(false), p_keys(keys)
+{
+}
+
+HandyJsonBuilder::~HandyJsonBuilder(void)
+{
+	delete[] (this->p_stack);
+}
+
+void			HandyJsonBuilder::Reset()
+{
+	this->p_depth = 0;
+	this->p_item = 0;
+	this->p_started = false;
+}
+
+/* The root first, then a new child of the innermost container, named by Key() in an object */
+HandyJson*		HandyJsonBuilder::Next()
+{
+	HandyJson*	parent;
+	HandyJson*	item;
+
+	if ((item = this->p_item))
+	{
+		this->p_item = 0;
+		return (item);
+	}
+	if (!this->p_depth)
+	{
+		if (this->p_started)
+			return (0);		// A second root value.
+		this->p_started = true;
+		this->p_root->ClearValue();		// Every item is filled empty.
+		return (this->p_root);
+	}
+	parent = this->p_stack[this->p_depth - 1];
+	if (parent->GetType() != json_array || !(item = parent->NewItem()))
+		return (0);
+	parent->AppendChild(item);
+	return (item);
+}
+
+bool			HandyJsonBuilder::Start(eTypes type)
+{
+	HandyJson*	item;
+	HandyJson**	stack;
+
+	if (!(item = this->Next()))
+		return (false);
+	if (this->p_depth == this->p_stack_size)
+	{
+		this->p_stack_size = this->p_depth ? this->p_depth * 2 : 32;
+		if (!(stack = new HandyJson*[this->p_stack_size]))
+			return (false);
+		if (this->p_depth)
+			memcpy(stack, this->p_stack, this->p_depth * sizeof(HandyJson*));
+		delete[] (this->p_stack);
+		this->p_stack = stack;
+	}
+	item->p_type = type;
+	item->ResetChildren();
+	this->p_stack[this->p_depth++] = item;
+	return (true);
+}
+
+bool			HandyJsonBuilder::StartObject()
+{
+	return (this->Start(json_object));
+}
+
+bool			HandyJsonBuilder::StartArray()
+{
+	return (this->Start(json_array));
+}
+
+bool			HandyJsonBuilder::EndObject()
+{
+	if (!this->p_depth || this->p_item)
+		return (false);
+	--this->p_depth;
+	return (true);
+}
+
+bool			HandyJsonBuilder::EndArray()
+{
+	return (this->EndObject());
+}
+
+bool			HandyJsonBuilder::Key(const char* str, size_t len)
+{
+	HandyJson*	parent;
+	HandyJson*	item;
+
+	if (!this->p_depth || this->p_item)
+		return (false);
+	parent = this->p_stack[this->p_depth - 1];
+	if (parent->GetType() != json_object || !(item = parent->NewItem()))
+		return (false);
+	if (this->p_keys ? !item->PoolName(*this->p_keys, str, len) : !item->StoreStr(item->p_name, HandyJson::flag_name_in, str, len))
+	{
+		if (!item->GetArena())
+			delete (item);
+		return (false);
+	}
+	parent->AppendChild(item);
+	this->p_item = item;
+	return (true);
+}
+
+bool			HandyJsonBuilder::String(const char* str, size_t len)
+{
+	HandyJson*	item;
+
+	if (!(item = this->Next()) || !item->StoreStr(item->p_value.str, HandyJson::flag_str_in, str, len))
+		return (false);
+	item->p_type = json_string;
+	return (true);
+}
+
+bool			HandyJsonBuilder::Number(double d)
+{
+	HandyJson*	item;
+
+	if (!(item = this->Next()))
+		return (false);
+	item->p_type = json_number;
+	item->SetValDbl(d);
+	return (true);
+}
+
+bool			HandyJsonBuilder::Int64(int64_t i)
+{
+	HandyJson*	item;
+
+	if (!(item = this->Next()))
+		return (false);
+	item->p_type = json_number;
+	item->SetValInt64(i);
+	return (true);
+}
+
+bool			HandyJsonBuilder::UInt64(uint64_t u)
+{
+	HandyJson*	item;
+
+	if (!(item = this->Next()))
+		return (false);
+	item->p_type = json_number;
+	item->SetValUInt64(u);
+	return (true);
+}
+
+bool			HandyJsonBuilder::Bool(bool b)
+{
+	HandyJson*	item;
+
+	if (!(item = this->Next()))
+		return (false);
+	item->p_type = b ? json_true : json_false;
+	item->p_value.i = b ? 1 : 0;
+	return (true);
+}
+
+bool			HandyJsonBuilder::Null()
+{
+	HandyJson*	item;
+
+	if (!(item = this->Next()))
+		return (false);
+	item->p_type = json_null;
+	return (true);
+}
+
+/*
+	+-----------------+
+	| HandyJsonReader |
+	+-----------------+
+						*/
+HandyJsonReader::HandyJsonReader(const char* data) :
+	p_ptr(data), p_value(data), p_depth(0), p_first(false)
+{
+	this->p_ctx.start = data;
+	this->p_ctx.where = 0;
+	this->p_ctx.code = json_error_none;
+	this->p_ctx.handler = &this->p_skip;
+	this->p_ctx.scratch = 0;
+	this->p_ctx.size = 0;
+	this->p_ctx.stack = 0;
+	this->p_ctx.stack_size = 0;
+	this->p_ctx.max_depth = 0;
+}
+
+HandyJsonReader::~HandyJsonReader(void)
+{
+	delete[] (this->p_ctx.scratch);
+	delete[] (this->p_ctx.stack);
+}
+
+bool			HandyJsonReader::StartObject()
+{
+	const char*	ptr = this->Value();
+
+	if (!ptr)
+		return (false);
+	return (*ptr == '{' ? this->Open(ptr) : this->Mismatch());
+}
+
+/* The name of the next member, and the reader at its value */
+bool			HandyJsonReader::NextKey(const char*& key, size_t& len)
+{
+	const char*	ptr;
+
+	if (!this->p_ptr)
+		return (false);
+	ptr = HandyJson::Skip(this->p_ptr);
+	if (*ptr == '}')
+		return (this->Close(ptr));
+	if (!this->p_first)
+	{
+		if (*ptr != ',') { return (this->Fail(ptr, json_error_object)); }
+		ptr = HandyJson::Skip(ptr + 1);
+	}
+	this->p_first = false;
+	if (*ptr != '\"') { return (this->Fail(ptr, json_error_key)); }
+	if (!(ptr = this->String(ptr, key, len)))
+		return (false);
+	ptr = HandyJson::Skip(ptr);
+	if (*ptr != ':') { return (this->Fail(ptr, json_error_colon)); }
+	this->p_ptr = ptr + 1;
+	return (true);
+}
+
+bool			HandyJsonReader::StartArray()
+{
+	const char*	ptr = this->Value();
+
+	if (!ptr)
+		return (false);
+	return (*ptr == '[' ? this->Open(ptr) : this->Mismatch());
+}
+
+bool			HandyJsonReader::NextItem()
+{
+	const char*	ptr;
+
+	if (!this->p_ptr)
+		return (false);
+	ptr = HandyJson::Skip(this->p_ptr);
+	if (*ptr == ']')
+		return (this->Close(ptr));
+	if (!this->p_first)
+	{
+		if (*ptr != ',') { return (this->Fail(ptr, json_error_array)); }
+		ptr = HandyJson::Skip(ptr + 1);
+	}
+	this->p_first = false;
+	this->p_ptr = ptr;
+	return (true);
+}
+
+/* Guessed from the first byte, the read checks the rest */
+bool			HandyJsonReader::Peek(eTypes& type)
+{
+	const char*	ptr = this->Value();
+
+	if (!ptr)
+		return (false);
+	switch (*ptr)
+	{
+		case '{':	type = json_object; break;
+		case '[':	type = json_array; break;
+		case '\"':	type = json_string; break;
+		case 't':	type = json_true; break;
+		case 'f':	type = json_false; break;
+		case 'n':	type = json_null; break;
+		default:
+			if (*ptr != '-' && (*ptr < '0' || *ptr > '9'))
+				return (false);
+			type = json_number;
+			break;
+	}
+	return (true);
+}
+
+bool			HandyJsonReader::ReadNull()
+{
+	const char*	ptr = this->Value();
+
+	if (!ptr || strncmp(ptr, "null", 4))
+		return (false);
+	this->p_ptr = ptr + 4;
+	return (true);
+}
+
+bool			HandyJsonReader::ReadBool(bool& value)
+{
+	const char*	ptr = this->Value();
+
+	if (!ptr)
+		return (false);
+	if (!strncmp(ptr, "true", 4))			{ value = true; this->p_ptr = ptr + 4; }
+	else if (!strncmp(ptr, "false", 5))		{ value = false; this->p_ptr = ptr + 5; }
+	else									{ return (this->Mismatch()); }
+	return (true);
+}
+
+bool			HandyJsonReader::ReadInt64(int64_t& value)
+{
+	HandyJson::NumberValue	n;
+
+	if (!this->Number(n))
+		return (false);
+	if (!n.is_int || n.is_uint)
+		return (this->Fail(this->p_value, json_error_type));
+	value = (int64_t)n.bits;
+	return (true);
+}
+
+bool			HandyJsonReader::ReadUInt64(uint64_t& value)
+{
+	HandyJson::NumberValue	n;
+
+	if (!this->Number(n))
+		return (false);
+	if (!n.is_int || (!n.is_uint && (int64_t)n.bits < 0))
+		return (this->Fail(this->p_value, json_error_type));
+	value = n.bits;
+	return (true);
+}
+
+bool			HandyJsonReader::ReadDouble(double& value)
+{
+	HandyJson::NumberValue	n;
+
+	if (!this->Number(n))
+		return (false);
+	value = n.dbl;
+	return (true);
+}
+
+bool			HandyJsonReader::ReadString(const char*& str, size_t& len)
+{
+	const char*	ptr = this->Value();
+
+	if (!ptr)
+		return (false);
+	if (*ptr != '\"')
+		return (this->Mismatch());
+	if (!(ptr = this->String(ptr, str, len)))
+		return (false);
+	this->p_ptr = ptr;
+	return (true);
+}
+
+/* The parser reads one value and stops after it, its failures are moved to the position in the whole data */
+bool			HandyJsonReader::ReadTree(HandyJson& item, HandyJsonKeyPool* keys)
+{
+	const char*		ptr = this->Value();
+	const char*		end;
+	HandyJsonError	error;
+
+	if (!ptr)
+		return (false);
+	if (!item.ParseWithOpts(ptr, &end, false, &error, keys))
+		return (this->Fail(ptr + error.offset, error.code));
+	this->p_ptr = end;
+	return (true);
+}
+
+/* The event parser checks the value, and the events go nowhere */
+bool			HandyJsonReader::SkipValue()
+{
+	const char*	ptr = this->Value();
+
+	if (!ptr)
+		return (false);
+	this->p_ctx.max_depth = HandyJson::sp_max_depth - this->p_depth;
+	if (!(ptr = HandyJson::SaxValue(ptr, this->p_ctx)))
+	{
+		this->p_ptr = 0;
+		return (false);
+	}
+	this->p_ptr = ptr;
+	return (true);
+}
+
+bool			HandyJsonReader::Fail(eErrors code)
+{
+	if (!this->p_ptr)
+		return (false);
+	return (this->Fail(this->p_value, code));
+}
+
+bool			HandyJsonReader::Finish(const char** return_parse_end, bool require_null_terminated, HandyJsonError* error)
+{
+	return (HandyJson::Finish(this->p_ctx, this->p_ptr, return_parse_end, require_null_terminated, error));
+}
+
+const char*		HandyJsonReader::Value()
+{
+	if (!this->p_ptr)
+		return (0);
+	this->p_value = HandyJson::Skip(this->p_ptr);
+	return (this->p_value);
+}
+
+/* A value of another type is json_error_type, anything else is not a value at all */
+bool			HandyJsonReader::Mismatch()
+{
+	const char*	ptr = this->p_value;
+	bool		value;
+
+	value = *ptr == '{' || *ptr == '[' || *ptr == '\"' || *ptr == '-' || (*ptr >= '0' && *ptr <= '9') ||
+		!strncmp(ptr, "true", 4) || !strncmp(ptr, "false", 5) || !strncmp(ptr, "null", 4);
+	return (this->Fail(ptr, value ? json_error_type : json_error_value));
+}
+
+bool			HandyJsonReader::Number(HandyJson::NumberValue& n)
+{
+	const char*	ptr = this->Value();
+
+	if (!ptr)
+		return (false);
+	if (*ptr != '-' && (*ptr < '0' || *ptr > '9'))
+		return (this->Mismatch());
+	this->p_ptr = HandyJson::ScanNumber(ptr, n);
+	return (true);
+}
+
+bool			HandyJsonReader::Open(const char* ptr)
+{
+	if (this->p_depth == HandyJson::sp_max_depth) { return (this->Fail(ptr, json_error_depth)); }
+	++this->p_depth;
+	this->p_first = true;
+	this->p_ptr = ptr + 1;
+	return (true);
+}
+
+bool			HandyJsonReader::Close(const char* ptr)
+{
+	--this->p_depth;
+	this->p_first = false;		// The container was a value of its parent.
+	this->p_ptr = ptr + 1;
+	return (false);
+}
+
+bool			HandyJsonReader::Fail(const char* where, eErrors code)
+{
+	HandyJson::Fail(this->p_ctx, where, code);
+	this->p_ptr = 0;
+	return (false);
+}
+
+/* Same as HandyJson::SaxString(): the input itself when nothing is escaped, decoded in the scratch buffer otherwise */
+const char*		HandyJsonReader::String(const char* str, const char*& out, size_t& len)
+{
+	const char*	ptr;
+	char*		ptr2;
+	size_t		need;
+
+	ptr = HandyJson::ScanString(str + 1);
+	len = ptr - str - 1;
+	if (*ptr == '\"')
+	{
+		out = str + 1;
+		return (ptr + 1);
+	}
+	need = len + HandyJson::StringLength(ptr) + 1;
+	if (need > this->p_ctx.size)
+	{
+		delete[] (this->p_ctx.scratch);
+		this->p_ctx.size = need < 256 ? 256 : need;
+		if (!(this->p_ctx.scratch = new char[this->p_ctx.size]))
+		{
+			this->p_ctx.size = 0;
+			this->Fail(str, json_error_memory);
+			return (0);
+		}
+	}
+	memcpy(this->p_ctx.scratch, str + 1, len);
+	ptr2 = this->p_ctx.scratch + len;
+	ptr = HandyJson::DecodeString(ptr, ptr2);
+	if (*ptr != '\"')
+	{
+		this->Fail(str, json_error_string);
+		return (0);
+	}
+	*ptr2 = 0;
+	out = this->p_ctx.scratch;
+	len = ptr2 - this->p_ctx.scratch;
+	return (ptr + 1);
+}
+
+/*
+	+---------------+
+	| HandyJsonLazy |
+	+---------------+
+						*/
+HandyJsonLazy::HandyJsonLazy(void) :
+	p_data(0), p_index(0), p_count(0), p_size(0), p_arena(4096)
+{
+}
+
+HandyJsonLazy::~HandyJsonLazy(void)
+{
+	delete[] (this->p_index);
+}
+
+/*
+	One pass over the root value: strings are skipped, and each array or object
+	gets an entry in p_index, in the order of their openings. The entry keeps the
+	offset of the opening until the closing is found.
+*/
+bool			HandyJsonLazy::Parse(const char* data, HandyJsonError* error)
+{
+	HandyJson::ErrorContext	ctx;
+	const char*				ptr;
+	Container*				index;
+	size_t*					stack = 0;
+	size_t					depth = 0, stack_size = 0, k;
+	size_t					max_depth = HandyJson::GetMaxDepth();
+
+	ctx.start = data;
+	ctx.where = 0;
+	ctx.code = json_error_none;
+	this->p_data = 0;
+	this->p_count = 0;
+	this->p_arena.Reset();
+	ptr = HandyJson::Skip(data);
+	if (*ptr != '[' && *ptr != '{')
+	{
+		if (!*ptr) { HandyJson::Fail(ctx, ptr, json_error_value); }
+		else if (*ptr == '\"' && !*HandyJsonLazy::SkipString(ptr)) { HandyJson::Fail(ctx, ptr, json_error_string); }
+	}
+	else
+	{
+		for (; *ptr; ++ptr)
+		{
+			while (((*ptr | 0x20) & 0xF9) != 0x79 && *ptr != '\"' && *ptr)
+				++ptr;		// Not a bracket: the four of them, and a few letters, match 0x79 this way.
+			if (!*ptr)
+				break;
+			if (*ptr == '\"')
+			{
+				if (!*(ptr = HandyJsonLazy::SkipString(ptr)))
+				{
+					HandyJson::Fail(ctx, ptr, json_error_string);
+					break;
+				}
+			}
+			else if (*ptr == '[' || *ptr == '{')
+			{
+				if (depth == max_depth) { HandyJson::Fail(ctx, ptr, json_error_depth); break; }
+				if (depth == stack_size)
+				{
+					size_t*	s;
+
+					stack_size = depth ? depth * 2 : 32;
+					if (!(s = new size_t[stack_size])) { HandyJson::Fail(ctx, ptr, json_error_memory); break; }
+					if (depth)
+						memcpy(s, stack, depth * sizeof(size_t));
+					delete[] (stack);
+					stack = s;
+				}
+				if (this->p_count == this->p_size)
+				{
+					this->p_size = this->p_size ? this->p_size * 2 : 64;
+					if (!(index = new Container[this->p_size])) { HandyJson::Fail(ctx, ptr, json_error_memory); break; }
+					if (this->p_count)
+						memcpy(index, this->p_index, this->p_count * sizeof(Container));
+					delete[] (this->p_index);
+					this->p_index = index;
+				}
+				this->p_index[this->p_count].close = ptr - data;
+				stack[depth++] = this->p_count++;
+			}
+			else if (*ptr == ']' || *ptr == '}')
+			{
+				if (data[this->p_index[stack[depth - 1]].close] != (*ptr == ']' ? '[' : '{'))
+				{
+					HandyJson::Fail(ctx, ptr, data[this->p_index[stack[depth - 1]].close] == '[' ? json_error_array : json_error_object);
+					break;
+				}
+				k = stack[--depth];
+				this->p_index[k].close = ptr - data;
+				this->p_index[k].after = this->p_count;
+				if (!depth)
+					break;		// End of the root value.
+			}
+		}
+		if (depth && !ctx.where)
+			HandyJson::Fail(ctx, ptr, data[this->p_index[stack[depth - 1]].close] == '[' ? json_error_array : json_error_object);
+	}
+	delete[] (stack);
+	if (!ctx.where)
+		this->p_data = data;
+	return (HandyJson::Finish(ctx, ctx.where ? 0 : data, 0, false, error));
+}
+
+HandyJsonLazyItem	HandyJsonLazy::GetRoot() const
+{
+	if (!this->p_data)
+		return (HandyJsonLazyItem());
+	return (HandyJsonLazyItem(this, HandyJson::Skip(this->p_data), 0, 0, 0));
+}
+
+/* Same escapes as HandyJson::DecodeString(), so that both agree on the end */
+const char*		HandyJsonLazy::SkipString(const char* ptr)
+{
+	for (ptr = HandyJson::ScanString(ptr + 1); *ptr == '\\'; ptr = HandyJson::ScanString(ptr))
+	{
+		if (ptr[1] == 'u' && ptr[2] && ptr[3] && ptr[4] && ptr[5])
+			ptr += 6;
+		else if (ptr[1])
+			ptr += 2;
+		else
+			++ptr;
+	}
+	return (ptr);
+}
+
+/*
+	+-------------------+
+	| HandyJsonLazyItem |
+	+-------------------+
+							*/
+HandyJsonLazyItem::HandyJsonLazyItem(void) :
+	p_doc(0), p_ptr(0), p_name(0), p_ord(0), p_parent(0)
+{
+}
+
+HandyJsonLazyItem::HandyJsonLazyItem(const HandyJsonLazy* doc, const char* ptr, const char* name, size_t ord, char parent) :
+	p_doc(doc), p_ptr(ptr), p_name(name), p_ord(ord), p_parent(parent)
+{
+}
+
+eTypes			HandyJsonLazyItem::GetType() const
+{
+	if (!this->p_ptr)
+		return (json_null);
+	switch (*this->p_ptr)
+	{
+		case '{':	return (json_object);
+		case '[':	return (json_array);
+		case '\"':	return (json_string);
+		case 't':	return (json_true);
+		case 'f':	return (json_false);
+		case 'n':	return (json_null);
+		default:	return (json_number);
+	}
+}
+
+const char*		HandyJsonLazyItem::GetName() const
+{
+	return (this->p_name ? this->Decode(this->p_name) : 0);
+}
+
+const char*		HandyJsonLazyItem::GetValStr() const
+{
+	return (this->p_ptr && *this->p_ptr == '\"' ? this->Decode(this->p_ptr) : 0);
+}
+
+int				HandyJsonLazyItem::GetValInt() const
+{
+	HandyJson	item(json_number);
+
+	this->ReadNumber(item);
+	return (item.GetValInt());
+}
+
+int64_t			HandyJsonLazyItem::GetValInt64() const
+{
+	HandyJson	item(json_number);
+
+	this->ReadNumber(item);
+	return (item.GetValInt64());
+}
+
+uint64_t		HandyJsonLazyItem::GetValUInt64() const
+{
+	HandyJson	item(json_number);
+
+	this->ReadNumber(item);
+	return (item.GetValUInt64());
+}
+
+double			HandyJsonLazyItem::GetValDbl() const
+{
+	HandyJson	item(json_number);
+
+	this->ReadNumber(item);
+	return (item.GetValDbl());
+}
+
+HandyJsonLazyItem	HandyJsonLazyItem::GetChild() const
+{
+	if (!this->p_ptr || (*this->p_ptr != '[' && *this->p_ptr != '{'))
+		return (HandyJsonLazyItem());
+	return (this->Child(HandyJson::Skip(this->p_ptr + 1), this->p_ord + 1, *this->p_ptr));
+}
+
+HandyJsonLazyItem	HandyJsonLazyItem::GetNext() const
+{
+	const char*	ptr;
+	size_t		ord = this->p_ord;
+
+	if (!this->p_ptr || !this->p_parent)
+		return (HandyJsonLazyItem());
+	ptr = HandyJson::Skip(this->End(ord));
+	if (*ptr != ',')
+		return (HandyJsonLazyItem());
+	return (this->Child(HandyJson::Skip(ptr + 1), ord, this->p_parent));
+}
+
+HandyJsonLazyItem	HandyJsonLazyItem::GetObjectItem(const char* string) const
+{
+	HandyJsonLazyItem	c;
+
+	if (!this->p_ptr || *this->p_ptr != '{' || !string)
+		return (HandyJsonLazyItem());
+	for (c = this->GetChild(); c.IsValid() && !c.NameIs(string); c = c.GetNext()) ;
+	return (c);
+}
+
+int				HandyJsonLazyItem::GetArraySize() const
+{
+	HandyJsonLazyItem	c;
+	int					size = 0;
+
+	for (c = this->GetChild(); c.IsValid(); c = c.GetNext())
+		++size;
+	return (size);
+}
+
+HandyJsonLazyItem	HandyJsonLazyItem::GetArrayItem(int item) const
+{
+	HandyJsonLazyItem	c = this->GetChild();
+
+	while (item-- > 0 && c.IsValid())
+		c = c.GetNext();
+	return (c);
+}
+
+bool			HandyJsonLazyItem::Build(HandyJson& root, HandyJsonError* error) const
+{
+	if (!this->p_ptr)
+		return (false);
+	return (root.ParseWithOpts(this->p_ptr, 0, false, error));
+}
+
+/* ptr is a child in an array or an object (open), read its name first in an object */
+HandyJsonLazyItem	HandyJsonLazyItem::Child(const char* ptr, size_t ord, char open) const
+{
+	const char*	name = 0;
+
+	if (*ptr == ']' || *ptr == '}' || !*ptr)
+		return (HandyJsonLazyItem());
+	if (open == '{')
+	{
+		if (*ptr != '\"')
+			return (HandyJsonLazyItem());
+		name = ptr;
+		ptr = HandyJson::Skip(HandyJsonLazy::SkipString(ptr) + 1);
+		if (*ptr != ':')
+			return (HandyJsonLazyItem());
+		ptr = HandyJson::Skip(ptr + 1);
+	}
+	return (HandyJsonLazyItem(this->p_doc, ptr, name, ord, open));
+}
+
+/* Arrays and objects are skipped at once through the index, ord follows */
+const char*		HandyJsonLazyItem::End(size_t& ord) const
+{
+	const char*	ptr = this->p_ptr;
+
+	if (*ptr == '[' || *ptr == '{')
+	{
+		ord = this->p_doc->p_index[this->p_ord].after;
+		return (this->p_doc->p_data + this->p_doc->p_index[this->p_ord].close + 1);
+	}
+	if (*ptr == '\"')
+		return (HandyJsonLazy::SkipString(ptr) + 1);
+	while ((unsigned char)*ptr > 32 && !strchr(",:[]{}\"", *ptr))
+		++ptr;		// Stops before any bracket, which would have an entry in the index.
+	return (ptr);
+}
+
+bool			HandyJsonLazyItem::NameIs(const char* string) const
+{
+	const char*	ptr;
+	const char*	s = string;
+
+	for (ptr = this->p_name + 1; *ptr != '\"'; ++ptr, ++s)
+	{
+		if (*ptr == '\\')
+			return (!HandyJson::StrCaseCmp(this->GetName(), string));		// Escaped, compare it decoded.
+		if (tolower(*(const unsigned char*)ptr) != tolower(*(const unsigned char*)s))
+			return (false);
+	}
+	return (!*s);
+}
+
+void			HandyJsonLazyItem::ReadNumber(HandyJson& item) const
+{
+	HandyJson::NumberValue	n;
+
+	if (!this->p_ptr)
+		return;
+	if (*this->p_ptr == '-' || (*this->p_ptr >= '0' && *this->p_ptr <= '9'))
+	{
+		HandyJson::ScanNumber(this->p_ptr, n);
+		item.SetNumber(n);
+	}
+	else if (*this->p_ptr == 't')
+	{
+		item.p_type = json_true;
+		item.p_value.i = 1;
+	}
+}
+
+const char*		HandyJsonLazyItem::Decode(const char* str) const
+{
+	char*		out;
+	char*		ptr2;
+
+	if (!(out = this->p_doc->p_arena.AllocStr(HandyJson::StringLength(str + 1) + 1)))
+		return (0);
+	ptr2 = out;
+	HandyJson::DecodeString(str + 1, ptr2);
+	*ptr2 = 0;
+	return (out);
+}
+
+/*
+	+---------------+
+	| HandyJsonTape |
+	+---------------+
+						*/
+HandyJsonTape::HandyJsonTape(void) :
+	p_entries(0), p_count(0), p_size(0), p_strings(0), p_len(0), p_cap(0),
+	p_stack(0), p_depth(0), p_stack_size(0), p_name(0), p_name_len(0)
+{
+}
+
+HandyJsonTape::~HandyJsonTape(void)
+{
+	delete[] (this->p_entries);
+	delete[] (this->p_strings);
+	delete[] (this->p_stack);
+}
+
+void			HandyJsonTape::Clear()
+{
+	this->p_count = 0;
+	this->p_len = 0;
+	this->p_depth = 0;
+	this->p_name = 0;
+	this->p_name_len = 0;
+}
+
+HandyJsonTapeItem	HandyJsonTape::GetRoot() const
+{
+	if (!this->p_count || this->p_depth)
+		return (HandyJsonTapeItem());
+	return (HandyJsonTapeItem(this, 0, this->p_count));
+}
+
+bool			HandyJsonTape::Parse(const char* data, HandyJsonError* error)
+{
+	this->Clear();
+	if (HandyJson::ParseSaxWithOpts(data, *this, 0, false, error))
+		return (true);
+	this->Clear();
+	return (false);
+}
+
+/* Same walk as the HandyJson destructor: down to the children, then along the siblings and up */
+bool			HandyJsonTape::Load(const HandyJson& root)
+{
+	const HandyJson*	item = &root;
+	const HandyJson**	parents = 0;
+	const HandyJson**	p;
+	size_t				size = 0;
+	Entry*				e;
+	bool				ok = true;
+
+	this->Clear();
+	for (;;)
+	{
+		if (this->p_depth && this->p_entries[this->p_stack[this->p_depth - 1]].type == json_object && item->GetName())
+		{
+			if (!(ok = this->AddString(item->GetName(), item->GetNameLen(), this->p_name)))
+				break;
+			this->p_name_len = (uint32_t)item->GetNameLen();
+		}
+		if (item->GetType() == json_array || item->GetType() == json_object)
+		{
+			if (!(ok = this->Open(item->GetType())))
+				break;
+			if (item->GetChild())
+			{
+				if (this->p_depth > size)
+				{
+					size = this->p_stack_size;
+					if (!(p = new const HandyJson*[size]))
+					{
+						ok = false;
+						break;
+					}
+					if (this->p_depth > 1)
+						memcpy(p, parents, (this->p_depth - 1) * sizeof(HandyJson*));
+					delete[] (parents);
+					parents = p;
+				}
+				parents[this->p_depth - 1] = item;
+				item = item->GetChild();
+				continue;
+			}
+			this->Close();
+		}
+		else
+		{
+			if (!(e = this->Add(item->GetType())))
+			{
+				ok = false;
+				break;
+			}
+			if (item->GetType() == json_string)
+			{
+				if (!(ok = this->AddString(item->GetValStr() ? item->GetValStr() : "", item->GetValStrLen(), e->value)))
+					break;
+				e->size = item->GetValStrLen();
+			}
+			else if (item->GetType() == json_number)
+			{
+				if (item->p_flags & HandyJson::flag_int)
+				{
+					e->value = (uint64_t)item->p_value.i;
+					e->flags = (item->p_flags & HandyJson::flag_uint) ? (flag_int | flag_uint) : flag_int;
+				}
+				else
+					memcpy(&e->value, &item->p_value.d, sizeof(double));
+			}
+		}
+
+		/* Close the containers ending here, until one has a next child */
+		while (this->p_depth && !item->GetNext())
+		{
+			item = parents[this->p_depth - 1];
+			this->Close();
+		}
+		if (!this->p_depth)
+			break;
+		item = item->GetNext();
+	}
+	delete[] (parents);
+	if (!ok)
+		this->Clear();
+	return (ok);
+}
+
+HandyJsonTape::Entry*	HandyJsonTape::Add(eTypes type)
+{
+	Entry*		e;
+
+	if (this->p_count == this->p_size)
+	{
+		this->p_size = this->p_size ? this->p_size * 2 : 64;
+		if (!(e = new Entry[this->p_size]))
+			return (0);
+		if (this->p_count)
+			memcpy(e, this->p_entries, this->p_count * sizeof(Entry));
+		delete[] (this->p_entries);
+		this->p_entries = e;
+	}
+	e = &this->p_entries[this->p_count++];
+	e->value = 0;
+	e->size = 0;
+	e->name = this->p_name;
+	e->name_len = this->p_name_len;
+	e->type = (unsigned char)type;
+	e->flags = 0;
+	this->p_name = 0;
+	this->p_name_len = 0;
+	if (this->p_depth)
+		++this->p_entries[this->p_stack[this->p_depth - 1]].size;
+	return (e);
+}
+
+bool			HandyJsonTape::AddString(const char* str, size_t len, uint64_t& offset)
+{
+	char*		buf;
+	size_t		cap;
+
+	if (!this->p_len)
+		this->p_len = 1;		// Offset 0 means no name.
+	if (this->p_len + len + 1 > this->p_cap)
+	{
+		cap = this->p_cap ? this->p_cap * 2 : 1024;
+		if (cap < this->p_len + len + 1)
+			cap = this->p_len + len + 1;
+		if (!(buf = new char[cap]))
+			return (false);
+		if (this->p_strings)
+			memcpy(buf, this->p_strings, this->p_len);
+		delete[] (this->p_strings);
+		this->p_strings = buf;
+		this->p_cap = cap;
+	}
+	memcpy(this->p_strings + this->p_len, str, len);
+	this->p_strings[this->p_len + len] = 0;
+	offset = this->p_len;
+	this->p_len += len + 1;
+	return (true);
+}
+
+bool			HandyJsonTape::Open(eTypes type)
+{
+	size_t*		stack;
+
+	if (this->p_depth == this->p_stack_size)
+	{
+		this->p_stack_size = this->p_depth ? this->p_depth * 2 : 32;
+		if (!(stack = new size_t[this->p_stack_size]))
+			return (false);
+		if (this->p_depth)
+			memcpy(stack, this->p_stack, this->p_depth * sizeof(size_t));
+		delete[] (this->p_stack);
+		this->p_stack = stack;
+	}
+	if (!this->Add(type))
+		return (false);
+	this->p_stack[this->p_depth++] = this->p_count - 1;
+	return (true);
+}
+
+bool			HandyJsonTape::Close()
+{
+	if (!this->p_depth)
+		return (false);
+	this->p_entries[this->p_stack[--this->p_depth]].value = this->p_count;
+	return (true);
+}
+
+bool			HandyJsonTape::StartObject()
+{
+	return (this->Open(json_object));
+}
+
+bool			HandyJsonTape::EndObject()
+{
+	return (this->Close());
+}
+
+bool			HandyJsonTape::StartArray()
+{
+	return (this->Open(json_array));
+}
+
+bool			HandyJsonTape::EndArray()
+{
+	return (this->Close());
+}
+
+bool			HandyJsonTape::Key(const char* str, size_t len)
+{
+	if (!this->AddString(str, len, this->p_name))
+		return (false);
+	this->p_name_len = (uint32_t)len;
+	return (true);
+}
+
+bool			HandyJsonTape::String(const char* str, size_t len)
+{
+	uint64_t	offset;
+	Entry*		e;
+
+	if (!this->AddString(str, len, offset) || !(e = this->Add(json_string)))
+		return (false);
+	e->value = offset;
+	e->size = len;
+	return (true);
+}
+
+bool			HandyJsonTape::Number(double d)
+{
+	Entry*		e;
+
+	if (!(e = this->Add(json_number)))
+		return (false);
+	memcpy(&e->value, &d, sizeof(double));
+	return (true);
+}
+
+bool			HandyJsonTape::Int64(int64_t i)
+{
+	Entry*		e;
+
+	if (!(e = this->Add(json_number)))
+		return (false);
+	e->value = (uint64_t)i;
+	e->flags = flag_int;
+	return (true);
+}
+
+bool			HandyJsonTape::UInt64(uint64_t u)
+{
+	Entry*		e;
+
+	if (!(e = this->Add(json_number)))
+		return (false);
+	e->value = u;
+	e->flags = flag_int | flag_uint;
+	return (true);
+}
+
+bool			HandyJsonTape::Bool(bool b)
+{
+	return (this->Add(b ? json_true : json_false) != 0);
+}
+
+bool			HandyJsonTape::Null()
+{
+	return (this->Add(json_null) != 0);
+}
+
+/*
+	+-------------------+
+	| HandyJsonTapeItem |
+	+-------------------+
+							*/
+HandyJsonTapeItem::HandyJsonTapeItem(void) :
+	p_tape(0), p_index(0), p_end(0)
+{
+}
+
+HandyJsonTapeItem::HandyJsonTapeItem(const HandyJsonTape* tape, size_t index, size_t end) :
+	p_tape(tape), p_index(index), p_end(end)
+{
+}
+
+eTypes			HandyJsonTapeItem::GetType() const
+{
+	return (this->p_tape ? (eTypes)this->p_tape->p_entries[this->p_index].type : json_null);
+}
+
+const char*		HandyJsonTapeItem::GetName() const
+{
+	if (!this->p_tape || !this->p_tape->p_entries[this->p_index].name)
+		return (0);
+	return (this->p_tape->p_strings + this->p_tape->p_entries[this->p_index].name);
+}
+
+size_t			HandyJsonTapeItem::GetNameLen() const
+{
+	return (this->p_tape ? this->p_tape->p_entries[this->p_index].name_len : 0);
+}
+
+const char*		HandyJsonTapeItem::GetValStr() const
+{
+	if (this->GetType() != json_string)
+		return (0);
+	return (this->p_tape->p_strings + this->p_tape->p_entries[this->p_index].value);
+}
+
+size_t			HandyJsonTapeItem::GetValStrLen() const
+{
+	return (this->GetType() == json_string ? (size_t)this->p_tape->p_entries[this->p_index].size : 0);
+}
+
+int				HandyJsonTapeItem::GetValInt() const
+{
+	HandyJson	item(json_number);
+
+	this->ReadNumber(item);
+	return (item.GetValInt());
+}
+
+int64_t			HandyJsonTapeItem::GetValInt64() const
+{
+	HandyJson	item(json_number);
+
+	this->ReadNumber(item);
+	return (item.GetValInt64());
+}
+
+uint64_t		HandyJsonTapeItem::GetValUInt64() const
+{
+	HandyJson	item(json_number);
+
+	this->ReadNumber(item);
+	return (item.GetValUInt64());
+}
+
+double			HandyJsonTapeItem::GetValDbl() const
+{
+	const HandyJsonTape::Entry*	e;
+	double						d = 0;
+
+	if (this->GetType() != json_number)
+		return (0);
+	e = &this->p_tape->p_entries[this->p_index];
+	if (e->flags & HandyJsonTape::flag_uint)
+		return ((double)e->value);
+	if (e->flags & HandyJsonTape::flag_int)
+		return ((double)(int64_t)e->value);
+	memcpy(&d, &e->value, sizeof(double));
+	return (d);
+}
+
+HandyJsonTapeItem	HandyJsonTapeItem::GetChild() const
+{
+	if (!this->GetArraySize())
+		return (HandyJsonTapeItem());
+	return (HandyJsonTapeItem(this->p_tape, this->p_index + 1, this->p_tape->p_entries[this->p_index].value));
+}
+
+HandyJsonTapeItem	HandyJsonTapeItem::GetNext() const
+{
+	size_t		next;
+
+	if (!this->p_tape || (next = this->Next()) >= this->p_end)
+		return (HandyJsonTapeItem());
+	return (HandyJsonTapeItem(this->p_tape, next, this->p_end));
+}
+
+HandyJsonTapeItem	HandyJsonTapeItem::GetObjectItem(const char* string) const
+{
+	HandyJsonTapeItem	c;
+
+	if (this->GetType() != json_object || !string)
+		return (HandyJsonTapeItem());
+	for (c = this->GetChild(); c.IsValid() && HandyJson::StrCaseCmp(c.GetName(), string); c = c.GetNext()) ;
+	return (c);
+}
+
+int				HandyJsonTapeItem::GetArraySize() const
+{
+	if (this->GetType() != json_array && this->GetType() != json_object)
+		return (0);
+	return ((int)this->p_tape->p_entries[this->p_index].size);
+}
+
+HandyJsonTapeItem	HandyJsonTapeItem::GetArrayItem(int item) const
+{
+	HandyJsonTapeItem	c = this->GetChild();
+
+	while (item-- > 0 && c.IsValid())
+		c = c.GetNext();
+	return (c);
+}
+
+bool			HandyJsonTapeItem::Build(HandyJson& root) const
+{
+	HandyJsonBuilder	builder(root);
+
+	return (this->Fire(builder));
+}
+
+/* The entries of the value in order, the containers ending at each entry are closed after it */
+bool			HandyJsonTapeItem::Fire(HandyJsonHandler& handler) const
+{
+	const HandyJsonTape::Entry*	entries;
+	const char*					strings;
+	size_t*						stack = 0;
+	size_t*						s;
+	size_t						depth = 0, size = 0, i, end;
+	double						d;
+	bool						ok = true;
+
+	if (!this->p_tape)
+		return (false);
+	entries = this->p_tape->p_entries;
+	strings = this->p_tape->p_strings;
+	end = this->Next();
+	for (i = this->p_index; ok && i < end; ++i)
+	{
+		const HandyJsonTape::Entry&	e = entries[i];
+
+		if (i > this->p_index && e.name && !handler.Key(strings + e.name, e.name_len))
+			break;
+		switch (e.type)
+		{
+			case json_false:	ok = handler.Bool(false);	break;
+			case json_true:		ok = handler.Bool(true);	break;
+			case json_null:		ok = handler.Null();		break;
+			case json_string:	ok = handler.String(strings + e.value, (size_t)e.size);	break;
+			case json_number:
+				if (e.flags & HandyJsonTape::flag_uint)		ok = handler.UInt64(e.value);
+				else if (e.flags & HandyJsonTape::flag_int)	ok = handler.Int64((int64_t)e.value);
+				else
+				{
+					memcpy(&d, &e.value, sizeof(double));
+					ok = handler.Number(d);
+				}
+				break;
+			default:
+				ok = e.type == json_array ? handler.StartArray() : handler.StartObject();
+				if (!ok || e.value == i + 1)
+				{
+					ok = ok && (e.type == json_array ? handler.EndArray() : handler.EndObject());
+					break;
+				}
+				if (depth == size)
+				{
+					size = depth ? depth * 2 : 32;
+					if (!(s = new size_t[size]))
+					{
+						ok = false;
+						break;
+					}
+					if (depth)
+						memcpy(s, stack, depth * sizeof(size_t));
+					delete[] (stack);
+					stack = s;
+				}
+				stack[depth++] = i;
+				continue;
+		}
+		while (ok && depth && entries[stack[depth - 1]].value == i + 1)
+			ok = entries[stack[--depth]].type == json_array ? handler.EndArray() : handler.EndObject();
+	}
+	delete[] (stack);
+	return (ok && i == end);
+}
+
+size_t			HandyJsonTapeItem::Next() const
+{
+	const HandyJsonTape::Entry&	e = this->p_tape->p_entries[this->p_index];
+
+	return (e.type == json_array || e.type == json_object ? (size_t)e.value : this->p_index + 1);
+}
+
+void			HandyJsonTapeItem::ReadNumber(HandyJson& item) const
+{
+	const HandyJsonTape::Entry*	e;
+	double						d;
+
+	if (!this->p_tape)
+		return;
+	e = &this->p_tape->p_entries[this->p_index];
+	if (e->type == json_true)
+	{
+		item.p_type = json_true;
+		item.p_value.i = 1;
+	}
+	else if (e->type != json_number)
+		return;
+	else if (e->flags & HandyJsonTape::flag_uint)
+		item.SetValUInt64(e->value);
+	else if (e->flags & HandyJsonTape::flag_int)
+		item.SetValInt64((int64_t)e->value);
+	else
+	{
+		memcpy(&d, &e->value, sizeof(double));
+		item.SetValDbl(d);
+	}
+}
+
+/*
+	+---------------+
+	| HandyJsonPath |
+	+---------------+
+						*/
+HandyJsonPath::HandyJsonPath(void) :
+	p_steps(0), p_count(0), p_names(0)
+{
+}
+
+HandyJsonPath::~HandyJsonPath(void)
+{
+	this->Clear();
+}
+
+void			HandyJsonPath::Clear()
+{
+	delete[] (this->p_steps);
+	delete[] (this->p_names);
+	this->p_steps = 0;
+	this->p_names = 0;
+	this->p_count = 0;
+}
+
+/* Each step starts with a '/', a '.' or a '[', and decoded names are never longer than the path */
+bool			HandyJsonPath::Compile(const char* path)
+{
+	size_t		len;
+
+	this->Clear();
+	if (!path)
+		return (false);
+	len = strlen(path);
+	if (!(this->p_steps = new Step[len + 1]) || !(this->p_names = new char[len + 1]))
+	{
+		this->Clear();
+		return (false);
+	}
+	if (*path == '$' ? this->CompilePath(path + 1) : this->CompilePointer(path))
+		return (true);
+	this->Clear();
+	return (false);
+}
+
+bool			HandyJsonPath::CompilePointer(const char* ptr)
+{
+	char*		out = this->p_names;
+	Step*		step;
+
+	while (*ptr)
+	{
+		if (*ptr++ != '/')
+			return (false);
+		step = &this->p_steps[this->p_count++];
+		step->type = step_member;
+		step->name = out;
+		step->begin = -1;
+		step->end = INT64_MAX;
+		for (; *ptr && *ptr != '/'; ++ptr)
+		{
+			if (*ptr != '~')
+				*out++ = *ptr;
+			else if (ptr[1] == '0' || ptr[1] == '1')
+				*out++ = *++ptr == '0' ? '~' : '/';
+			else
+				return (false);
+		}
+		*out = 0;
+		step->name_len = out - step->name;
+		step->hash = HandyJson::HashName(step->name);
+		++out;
+
+		/* A token of digits is also an array index, without leading zeros ("-", past the end, selects nothing) */
+		if (step->name_len && step->name_len < 19 && (step->name[0] != '0' || step->name_len == 1) &&
+			strspn(step->name, "0123456789") == step->name_len)
+			step->begin = strtoll(step->name, 0, 10);
+	}
+	return (true);
+}
+
+bool			HandyJsonPath::CompilePath(const char* ptr)
+{
+	char*		out = this->p_names;
+	char*		end;
+	char		quote;
+	Step*		step;
+
+	while (*ptr)
+	{
+		step = &this->p_steps[this->p_count++];
+		step->name = 0;
+		step->begin = 0;
+		step->end = INT64_MAX;
+		if (*ptr == '.')
+		{
+			if (*++ptr == '*')
+			{
+				step->type = step_any;
+				++ptr;
+				continue;
+			}
+			step->type = step_name;
+			step->name = out;
+			while (*ptr && *ptr != '.' && *ptr != '[')
+				*out++ = *ptr++;
+			if (out == step->name)
+				return (false);
+		}
+		else if (*ptr++ != '[')
+			return (false);
+		else
+		{
+			if (*ptr == '*')
+			{
+				step->type = step_any;
+				++ptr;
+			}
+			else if (*ptr == '\'' || *ptr == '"')
+			{
+				step->type = step_name;
+				step->name = out;
+				for (quote = *ptr++; *ptr != quote; *out++ = *ptr++)
+				{
+					if (*ptr == '\\')
+						++ptr;
+					if (!*ptr)
+						return (false);
+				}
+				++ptr;
+			}
+			else
+			{
+				step->type = step_index;
+				if (*ptr != ':')
+				{
+					step->begin = strtoll(ptr, &end, 10);
+					if (end == ptr)
+						return (false);
+					ptr = end;
+				}
+				if (*ptr == ':')
+				{
+					step->type = step_slice;
+					if (*++ptr != ']')
+					{
+						step->end = strtoll(ptr, &end, 10);
+						if (end == ptr)
+							return (false);
+						ptr = end;
+					}
+				}
+			}
+			if (*ptr++ != ']')
+				return (false);
+		}
+		if (step->name)
+		{
+			*out = 0;
+			step->name_len = out - step->name;
+			step->hash = HandyJson::HashName(step->name);
+			++out;
+		}
+	}
+	return (true);
+}
+
+HandyJson*		HandyJsonPath::Find(const HandyJson& root) const
+{
+	HandyJson*	match = 0;
+	size_t		count = 0;
+
+	this->Collect(&root, 0, &match, 1, count, false);
+	return (match);
+}
+
+size_t			HandyJsonPath::FindAll(const HandyJson& root, HandyJson** matches, size_t size) const
+{
+	size_t		count = 0;
+
+	this->Collect(&root, 0, matches, size, count, true);
+	return (count);
+}
+
+/*
+	Match the steps from n on, below item. The recursion is as deep as the path, not
+	as the data. Returns false to stop, once the first match is found when all is false.
+*/
+bool			HandyJsonPath::Collect(const HandyJson* item, size_t n, HandyJson** matches, size_t size, size_t& count, bool all) const
+{
+	const Step*	step;
+	HandyJson*	c = 0;
+	int64_t		items, begin, end;
+
+	if (n == this->p_count)
+	{
+		if (count < size)
+			matches[count] = (HandyJson*)item;
+		++count;
+		return (all);
+	}
+	step = &this->p_steps[n];
+	items = item->GetArraySize();
+	begin = step->begin < 0 ? step->begin + items : step->begin;
+	switch (step->type)
+	{
+		case step_name:
+			if (item->GetType() == json_object)
+				c = item->FindItem(step->name, step->hash);
+			return (!c || this->Collect(c, n + 1, matches, size, count, all));
+		case step_member:
+			if (item->GetType() == json_object)
+				c = item->FindItem(step->name, step->hash);
+			else if (item->GetType() == json_array && step->begin >= 0 && step->begin < items)
+				c = item->GetArrayItem((int)step->begin);
+			return (!c || this->Collect(c, n + 1, matches, size, count, all));
+		case step_index:
+			if (item->GetType() == json_array && begin >= 0 && begin < items)
+				c = item->GetArrayItem((int)begin);
+			return (!c || this->Collect(c, n + 1, matches, size, count, all));
+		case step_slice:
+			if (item->GetType() != json_array)
+				return (true);
+			end = step->end < 0 ? step->end + items : step->end;
+			if (begin < 0)
+				begin = 0;
+			if (end > items)
+				end = items;
+			for (c = begin < end ? item->GetArrayItem((int)begin) : 0; c && begin < end; c = c->GetNext(), ++begin)
+				if (!this->Collect(c, n + 1, matches, size, count, all))
+					return (false);
+			return (true);
+		default:
+			if (item->GetType() != json_array && item->GetType() != json_object)
+				return (true);
+			for (c = item->GetChild(); c; c = c->GetNext())
+				if (!this->Collect(c, n + 1, matches, size, count, all))
+					return (false);
+			return (true);
+	}
+}
+
+/* For the filter, which meets the children one by one and never knows the size of an array */
+bool			HandyJsonPath::Selects(const Step& step, const char* name, size_t len, size_t index, bool is_array) const
+{
+	size_t		i;
+
+	switch (step.type)
+	{
+		case step_index:
+			return (is_array && step.begin >= 0 && index == (size_t)step.begin);
+		case step_slice:
+			return (is_array && step.begin >= 0 && step.end >= 0 && index >= (size_t)step.begin && index < (uint64_t)step.end);
+		case step_any:
+			return (true);
+		default:
+			if (is_array)
+				return (step.type == step_member && step.begin >= 0 && index == (size_t)step.begin);
+			if (len != step.name_len)
+				return (false);
+			for (i = 0; i < len && tolower((unsigned char)name[i]) == tolower((unsigned char)step.name[i]); ++i) ;
+			return (i == len);
+	}
+}
+
+/*
+	+---------------------+
+	| HandyJsonPathFilter |
+	+---------------------+
+							*/
+HandyJsonPathFilter::HandyJsonPathFilter(const HandyJsonPath& path, HandyJsonHandler& handler) :
+	p_path(&path), p_handler(&handler), p_stack(0), p_depth(0), p_stack_size(0),
+	p_inside(0), p_key_match(false), p_matches(0)
+{
+}
+
+HandyJsonPathFilter::~HandyJsonPathFilter(void)
+{
+	delete[] (this->p_stack);
+}
+
+void			HandyJsonPathFilter::Reset()
+{
+	this->p_depth = 0;
+	this->p_inside = 0;
+	this->p_key_match = false;
+	this->p_matches = 0;
+}
+
+/*
+	A value at depth d is checked against step d - 1, if its parent matched the
+	steps before. Containers are only tracked outside of the matches: inside one,
+	everything goes to the handler and p_inside counts the nesting.
+*/
+int				HandyJsonPathFilter::Enter(eTypes type)
+{
+	Frame*		parent = this->p_depth ? &this->p_stack[this->p_depth - 1] : 0;
+	Frame*		stack;
+	bool		match = true;
+
+	if (this->p_inside)
+		return (1);
+	if (parent)
+	{
+		match = parent->matched && (parent->is_array ?
+			this->p_path->Selects(this->p_path->p_steps[this->p_depth - 1], 0, 0, parent->index, true) : this->p_key_match);
+		++parent->index;
+	}
+	if (match && this->p_depth == this->p_path->p_count)
+		return (1);
+	if (type != json_array && type != json_object)
+		return (0);
+	if (this->p_depth == this->p_stack_size)
+	{
+		this->p_stack_size = this->p_depth ? this->p_depth * 2 : 32;
+		if (!(stack = new Frame[this->p_stack_size]))
+			return (-1);
+		if (this->p_depth)
+			memcpy(stack, this->p_stack, this->p_depth * sizeof(Frame));
+		delete[] (this->p_stack);
+		this->p_stack = stack;
+	}
+	this->p_stack[this->p_depth].index = 0;
+	this->p_stack[this->p_depth].matched = match && this->p_depth < this->p_path->p_count;
+	this->p_stack[this->p_depth].is_array = type == json_array;
+	++this->p_depth;
+	return (0);
+}
+
+bool			HandyJsonPathFilter::Leave()
+{
+	if (this->p_depth)
+		--this->p_depth;
+	return (true);
+}
+
+bool			HandyJsonPathFilter::StartObject()
+{
+	int			r = this->Enter(json_object);
+
+	if (r <= 0)
+		return (!r);
+	++this->p_inside;
+	return (this->p_handler->StartObject());
+}
+
+bool			HandyJsonPathFilter::EndObject()
+{
+	if (!this->p_inside)
+		return (this->Leave());
+	if (!--this->p_inside)
+		++this->p_matches;
+	return (this->p_handler->EndObject());
+}
+
+bool			HandyJsonPathFilter::StartArray()
+{
+	int			r = this->Enter(json_array);
+
+	if (r <= 0)
+		return (!r);
+	++this->p_inside;
+	return (this->p_handler->StartArray());
+}
+
+bool			HandyJsonPathFilter::EndArray()
+{
+	if (!this->p_inside)
+		return (this->Leave());
+	if (!--this->p_inside)
+		++this->p_matches;
+	return (this->p_handler->EndArray());
+}
+
+bool			HandyJsonPathFilter::Key(const char* str, size_t len)
+{
+	size_t		d = this->p_depth;
+
+	if (this->p_inside)
+		return (this->p_handler->Key(str, len));
+	this->p_key_match = d && d <= this->p_path->p_count && this->p_stack[d - 1].matched &&
+		this->p_path->Selects(this->p_path->p_steps[d - 1], str, len, this->p_stack[d - 1].index, false);
+	return (true);
+}
+
+bool			HandyJsonPathFilter::String(const char* str, size_t len)
+{
+	int			r = this->Enter(json_string);
+
+	if (r <= 0)
+		return (!r);
+	this->p_matches += !this->p_inside;
+	return (this->p_handler->String(str, len));
+}
+
+bool			HandyJsonPathFilter::Number(double d)
+{
+	int			r = this->Enter(json_number);
+
+	if (r <= 0)
+		return (!r);
+	this->p_matches += !this->p_inside;
+	return (this->p_handler->Number(d));
+}
+
+bool			HandyJsonPathFilter::Int64(int64_t i)
+{
+	int			r = this->Enter(json_number);
+
+	if (r <= 0)
+		return (!r);
+	this->p_matches += !this->p_inside;
+	return (this->p_handler->Int64(i));
+}
+
+bool			HandyJsonPathFilter::UInt64(uint64_t u)
+{
+	int			r = this->Enter(json_number);
+
+	if (r <= 0)
+		return (!r);
+	this->p_matches += !this->p_inside;
+	return (this->p_handler->UInt64(u));
+}
+
+bool			HandyJsonPathFilter::Bool(bool b)
+{
+	int			r = this->Enter(b ? json_true : json_false);
+
+	if (r <= 0)
+		return (!r);
+	this->p_matches += !this->p_inside;
+	return (this->p_handler->Bool(b));
+}
+
+bool			HandyJsonPathFilter::Null()
+{
+	int			r = this->Enter(json_null);
+
+	if (r <= 0)
+		return (!r);
+	this->p_matches += !this->p_inside;
+	return (this->p_handler->Null());
+}
+
+/*
+	+-----------------+
+	| HandyJsonWriter |
+	+-----------------+
+						*/
+HandyJsonWriter::HandyJsonWriter(HandyJsonSink& sink, bool formatted, size_t buffer) :
+	p_sink(&sink), p_buf(0), p_len(0), p_size(buffer ? buffer : HANDYJSON_WRITE_BUFFER),
+	p_stack(0), p_depth(0), p_stack_size(0), p_formatted(formatted), p_key(false), p_started(false), p_failed(false)
+{
+	if (this->p_size < 64)
+		this->p_size = 64;			// Room for any number.
+	if (!(this->p_buf = new char[this->p_size]))
+		this->p_failed = true;
+}
+
+HandyJsonWriter::~HandyJsonWriter(void)
+{
+	this->Flush();
+	delete[] (this->p_buf);
+	delete[] (this->p_stack);
+}
+
+bool			HandyJsonWriter::Flush()
+{
+	if (this->p_failed)
+		return (false);
+	if (this->p_len && !this->p_sink->Write(this->p_buf, this->p_len))
+		this->p_failed = true;
+	this->p_len = 0;
+	return (!this->p_failed);
+}
+
+void			HandyJsonWriter::Reset()
+{
+	this->p_len = 0;
+	this->p_depth = 0;
+	this->p_key = false;
+	this->p_started = false;
+	this->p_failed = !this->p_buf;
+}
+
+bool			HandyJsonWriter::StartObject()
+{
+	return (this->Open(true));
+}
+
+bool			HandyJsonWriter::EndObject()
+{
+	return (this->Close(true));
+}
+
+bool			HandyJsonWriter::StartArray()
+{
+	return (this->Open(false));
+}
+
+bool			HandyJsonWriter::EndArray()
+{
+	return (this->Close(false));
+}
+
+/* Print() puts the comma after a value, the writer when the next one comes: the output is the same */
+bool			HandyJsonWriter::Key(const char* str, size_t len)
+{
+	Level*		top = this->p_depth ? &this->p_stack[this->p_depth - 1] : 0;
+
+	if (this->p_failed || !top || !top->object || this->p_key)
+		return (!(this->p_failed = true));
+	if (!top->empty && !this->Put(",", 1))
+		return (false);
+	if (this->p_formatted && (!this->Put("\n", 1) || !this->PutTabs(this->p_depth)))
+		return (false);
+	top->empty = false;
+	if (!this->PutEscaped(str, len) || !(this->p_formatted ? this->Put(":\t", 2) : this->Put(":", 1)))
+		return (false);
+	this->p_key = true;
+	return (true);
+}
+
+bool			HandyJsonWriter::String(const char* str, size_t len)
+{
+	return (this->Value() && this->PutEscaped(str, len));
+}
+
+bool			HandyJsonWriter::Number(double d)
+{
+	char*		ptr;
+
+	if (!this->Value() || !(ptr = this->Reserve(32)))
+		return (false);
+	this->p_len = HandyJson::WriteDouble(ptr, d) - this->p_buf;
+	return (true);
+}
+
+bool			HandyJsonWriter::Int64(int64_t i)
+{
+	char*		ptr;
+
+	if (!this->Value() || !(ptr = this->Reserve(32)))
+		return (false);
+	if (i < 0)
+	{
+		*ptr++ = '-';
+		ptr = HandyJson::WriteUInt64(ptr, (uint64_t)0 - (uint64_t)i);
+	}
+	else
+		ptr = HandyJson::WriteUInt64(ptr, (uint64_t)i);
+	this->p_len = ptr - this->p_buf;
+	return (true);
+}
+
+bool			HandyJsonWriter::UInt64(uint64_t u)
+{
+	char*		ptr;
+
+	if (!this->Value() || !(ptr = this->Reserve(32)))
+		return (false);
+	this->p_len = HandyJson::WriteUInt64(ptr, u) - this->p_buf;
+	return (true);
+}
+
+bool			HandyJsonWriter::Bool(bool b)
+{
+	return (this->Value() && (b ? this->Put("true", 4) : this->Put("false", 5)));
+}
+
+bool			HandyJsonWriter::Null()
+{
+	return (this->Value() && this->Put("null", 4));
+}
+
+bool			HandyJsonWriter::Value()
+{
+	Level*		top = this->p_depth ? &this->p_stack[this->p_depth - 1] : 0;
+
+	if (this->p_failed)
+		return (false);
+	if (!top)
+	{
+		if (this->p_started && !this->Put("\n", 1))
+			return (false);
+		this->p_started = true;
+		return (true);
+	}
+	if (top->object)
+	{
+		if (!this->p_key)
+			return (!(this->p_failed = true));
+		this->p_key = false;
+		return (true);
+	}
+	if (!top->empty && !(this->p_formatted ? this->Put(", ", 2) : this->Put(",", 1)))
+		return (false);
+	top->empty = false;
+	return (true);
+}
+
+bool			HandyJsonWriter::Open(bool object)
+{
+	Level*		stack;
+
+	if (!this->Value() || !this->Put(object ? "{" : "[", 1))
+		return (false);
+	if (this->p_depth == this->p_stack_size)
+	{
+		this->p_stack_size = this->p_depth ? this->p_depth * 2 : 32;
+		if (!(stack = new Level[this->p_stack_size]))
+			return (!(this->p_failed = true));
+		if (this->p_depth)
+			memcpy(stack, this->p_stack, this->p_depth * sizeof(Level));
+		delete[] (this->p_stack);
+		this->p_stack = stack;
+	}
+	this->p_stack[this->p_depth].object = object;
+	this->p_stack[this->p_depth].empty = true;
+	++this->p_depth;
+	return (true);
+}
+
+/* An object closes on its own line, one tab left of its children (two for an empty one, as Print() does) */
+bool			HandyJsonWriter::Close(bool object)
+{
+	Level*		top = this->p_depth ? &this->p_stack[this->p_depth - 1] : 0;
+
+	if (this->p_failed || !top || top->object != object || this->p_key)
+		return (!(this->p_failed = true));
+	if (object && this->p_formatted && (!this->Put("\n", 1) ||
+		!this->PutTabs(this->p_depth - (top->empty ? (this->p_depth > 1 ? 2 : 1) : 1))))
+		return (false);
+	--this->p_depth;
+	return (this->Put(object ? "}" : "]", 1));
+}
+
+bool			HandyJsonWriter::Put(const char* str, size_t len)
+{
+	if (this->p_len + len > this->p_size)
+	{
+		if (!this->Flush())
+			return (false);
+		if (len >= this->p_size)
+		{
+			if (!this->p_sink->Write(str, len))
+				this->p_failed = true;
+			return (!this->p_failed);
+		}
+	}
+	memcpy(this->p_buf + this->p_len, str, len);
+	this->p_len += len;
+	return (true);
+}
+
+/* Same escapes as HandyJson::PrintStringPtr(), the plain runs between them are copied whole */
+bool			HandyJsonWriter::PutEscaped(const char* str, size_t len)
+{
+	const char*		end = str + len;
+	const char*		run;
+	char			esc[8];
+	unsigned char	c;
+
+	if (!this->Put("\"", 1))
+		return (false);
+	while (str < end)
+	{
+		for (run = str; str < end && (unsigned char)*str > 31 && *str != '\"' && *str != '\\'; ++str) ;
+		if (str > run && !this->Put(run, str - run))
+			return (false);
+		if (str == end)
+			break;
+		esc[0] = '\\';
+		switch (c = *str++)
+		{
+			case '\\':	esc[1] = '\\';	break;
+			case '\"':	esc[1] = '\"';	break;
+			case '\b':	esc[1] = 'b';	break;
+			case '\f':	esc[1] = 'f';	break;
+			case '\n':	esc[1] = 'n';	break;
+			case '\r':	esc[1] = 'r';	break;
+			case '\t':	esc[1] = 't';	break;
+			default:
+				sprintf(esc + 1, "u%04x", c);
+				if (!this->Put(esc, 6))
+					return (false);
+				continue;
+		}
+		if (!this->Put(esc, 2))
+			return (false);
+	}
+	return (this->Put("\"", 1));
+}
+
+bool			HandyJsonWriter::PutTabs(size_t n)
+{
+	static const char	tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+	for (; n > 16; n -= 16)
+		if (!this->Put(tabs, 16))
+			return (false);
+	return (this->Put(tabs, n));
+}
+
+char*			HandyJsonWriter::Reserve(size_t len)
+{
+	if (this->p_len + len > this->p_size && !this->Flush())
+		return (0);
+	return (this->p_buf + this->p_len);
+}
+
+/*
+	+-----------------+
+	| HandyJson sinks |
+	+-----------------+
+						*/
+bool			HandyJsonFileSink::Write(const char* data, size_t size)
+{
+	return (fwrite(data, 1, size, this->p_file) == size);
+}
+
+bool			HandyJsonFdSink::Write(const char* data, size_t size)
+{
+#if defined(_WIN32)
+	int			n;
+
+	for (; size; data += n, size -= n)
+		if ((n = _write(this->p_fd, data, (unsigned)(size < 0x40000000 ? size : 0x40000000))) <= 0)
+			return (false);
+	return (true);
+#elif defined(HANDYJSON_MMAP)
+	ssize_t		n;
+
+	while (size)
+	{
+		if ((n = write(this->p_fd, data, size)) < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return (false);
+		data += n;
+		size -= n;
+	}
+	return (true);
+#else
+	(void)data;
+	(void)size;
+	return (false);
+#endif
+}
+
+bool			HandyJsonStreamSink::Write(const char* data, size_t size)
 {
-	unsigned h = 0;
-
-	if (*str >= '0' && *str <= '9') h += (*str) - '0';
-	else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
-	else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
-	else return (0);
-
-	h = h << 4;
-	++str;
-
-	if (*str >= '0' && *str <= '9') h += (*str) - '0';
-	else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
-	else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
-	else return (0);
+	this->p_stream->write(data, (std::streamsize)size);
+	return (this->p_stream->good());
+}
 
-	h = h << 4;
-	++str;
+#ifdef HANDYJSON_THREADS
+/*
+	+----------------+
+	| HandyJsonLines |
+	+----------------+
+						*/
+struct			HandyJsonLines::Chunk
+{
+	struct	Entry
+	{
+		HandyJson*		doc;		// The document, null if the line did not parse.
+		size_t			line;		// Line in the chunk, from 0.
+		size_t			pos;		// Offset of the line in the chunk.
+		HandyJsonError	error;		// Why it did not parse.
+	};
 
-	if (*str >= '0' && *str <= '9') h += (*str) - '0';
-	else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
-	else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
-	else return (0);
+	const char*			begin;		// The lines, in the input.
+	const char*			end;		//
+	std::vector<char>	text;		// Their copy, each line zero terminated.
+	HandyJsonArena		arena;		// The documents.
+	std::vector<Entry>	entries;	// In line order.
+	size_t				newlines;	// Ends of line in the chunk.
+	bool				done;		// Parsed, waiting for the handler.
+};
 
-	h = h << 4;
-	++str;
-	
-	if (*str >= '0' && *str <= '9') h += (*str) - '0';
-	else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
-	else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
-	else return (0);
+struct			HandyJsonLines::Run
+{
+	const char*					data;		// Beginning of the input.
+	std::vector<const char*>	cuts;		// Chunk i is [cuts[i], cuts[i + 1]).
+	Chunk*						slots;		// Chunk i is parsed in slots[i % window] (Parse), or in its thread slot (ParseSax).
+	unsigned					window;		// Chunks parsed and not delivered, at most.
+	HandyJsonHandler* const*	handlers;	// One per thread, for ParseSax().
+	size_t						next;		// Next chunk to claim.
+	size_t						delivered;	// Chunks given to the handler.
+	bool						stop;		// Stop claiming chunks.
+	HandyJsonError				error;		// First error of ParseSax(), in input order.
+	std::mutex					lock;
+	std::condition_variable		claimable;	// A slot was freed, or stop.
+	std::condition_variable		parsed;		// A chunk is done.
+};
 
-	return (h);
+HandyJsonLines::HandyJsonLines(unsigned threads) :
+	p_threads(threads), p_chunk_size(1024 * 1024), p_window(0)
+{
+	if (!this->p_threads)
+		this->p_threads = std::thread::hardware_concurrency();
+	if (!this->p_threads)
+		this->p_threads = 1;
+	this->p_window = this->p_threads * 2;
 }
 
-const char*		HandyJson::ParseString(const char* str)
+void			HandyJsonLines::Cut(const char* data, size_t size, Run& run) const
 {
-	const char*	ptr = str + 1;
-	char*		ptr2;
-	char*		out;
-	int			len = 0;
-	unsigned	uc,uc2;
+	const char*	end = data + size;
+	const char*	ptr = data;
+	const char*	cut;
 
-	if (*str!='\"')	{ HandyJson::sp_err = str; return (0); }
-	
-	while (*ptr != '\"' && *ptr && ++len) if (*ptr++ == '\\') ptr++;
-	
-	out = new char[len + 1]();
-	if (!out) return (0);
-	
-	ptr = str + 1;
-	ptr2 = out;
-	while (*ptr!='\"' && *ptr)
+	run.data = data;
+	run.cuts.push_back(ptr);
+	while (ptr < end)
 	{
-		if (*ptr != '\\') *ptr2++ = *ptr++;
+		if ((size_t)(end - ptr) <= this->p_chunk_size)
+			cut = end;
+		else if ((cut = (const char*)memchr(ptr + this->p_chunk_size, '\n', end - ptr - this->p_chunk_size)))
+			++cut;
 		else
-		{
-			ptr++;
-			switch (*ptr)
-			{
-				case 'b': *ptr2++='\b';	break;
-				case 'f': *ptr2++='\f';	break;
-				case 'n': *ptr2++='\n';	break;
-				case 'r': *ptr2++='\r';	break;
-				case 't': *ptr2++='\t';	break;
-				case 'u':
-					uc = this->ParseHex4(ptr + 1); ptr += 4;
-					if ((uc >= 0xDC00 && uc <= 0xDFFF) || uc == 0) break;
-					if (uc >= 0xD800 && uc <= 0xDBFF)
-					{
-						if (ptr[1] != '\\' || ptr[2] != 'u') break;
-						uc2 = this->ParseHex4(ptr+3); ptr += 6;
-						if (uc2 < 0xDC00 || uc2 > 0xDFFF) break;
-						uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
-					}
-					len = 4;
-					if (uc < 0x80) len = 1;
-					else if (uc < 0x800) len = 2;
-					else if (uc < 0x10000) len = 3;
-					ptr2 += len;
-					
-					switch (len) {
-						case 4: *--ptr2 = ((uc | 0x80) & 0xBF); uc >>= 6;
-						case 3: *--ptr2 = ((uc | 0x80) & 0xBF); uc >>= 6;
-						case 2: *--ptr2 = ((uc | 0x80) & 0xBF); uc >>= 6;
-						case 1: *--ptr2 = (uc | HandyJson::sp_firstByteMark[len]);
-					}
-					ptr2 += len;
-					break;
-				default: 
-					*ptr2++ = *ptr; 
-					break;
-			}
-			ptr++;
-		}
+			cut = end;
+		run.cuts.push_back(cut);
+		ptr = cut;
 	}
-	*ptr2 = 0;
-	if (*ptr=='\"') ptr++;
-	this->p_value_as_str = out;
-    this->p_type = json_string;
-	return (ptr);
 }
 
-char*			HandyJson::PrintStringPtr(const char* str) const
+/* Parse the lines of a chunk into its arena, or fire their events if sax is given */
+bool			HandyJsonLines::ParseChunk(Chunk& c, HandyJsonHandler* sax)
 {
-	const char*		ptr;
-	char*			ptr2, *out;
-	int				len = 0;
-	unsigned char	token;
-	
-	if (!str) return (0);
-	ptr = str;
-	while ((token = *ptr) && ++len) 
-	{
-		if (strchr("\"\\\b\f\n\r\t", token))
-			len++;
-		else if (token < 32) 
-			len += 5;
-		ptr++;
-	}
-	out = new char[len + 3]();
-	if (!out) return (0);
+	Chunk::Entry	e;
+	char*			text;
+	char*			ptr;
+	char*			eol;
+	char*			end;
+	const char*		p;
 
-	ptr2 = out;
-	ptr = str;
-	*ptr2++ = '\"';
-	while (*ptr)
+	c.text.assign(c.begin, c.end);
+	c.text.push_back(0);
+	text = &c.text[0];
+	end = text + (c.end - c.begin);
+	c.newlines = 0;
+	for (ptr = text; ptr < end; ptr = eol + 1, ++c.newlines)
 	{
-		if ((unsigned char)*ptr > 31 && *ptr != '\"' && *ptr != '\\')
-			*ptr2++ = *ptr++;
-		else
+		if (!(eol = (char*)memchr(ptr, '\n', end - ptr)))
+			eol = end;
+		*eol = 0;
+		for (p = ptr; *p && (unsigned char)*p <= 32; ++p) ;
+		if (!*p)
+			continue;		// Blank line.
+		e.line = c.newlines;
+		e.pos = ptr - text;
+		if (sax)
 		{
-			*ptr2++ = '\\';
-			switch (token = *ptr++)
+			if (!HandyJson::ParseSaxWithOpts(ptr, *sax, 0, true, &e.error))
 			{
-				case '\\':	*ptr2++='\\';	break;
-				case '\"':	*ptr2++='\"';	break;
-				case '\b':	*ptr2++='b';	break;
-				case '\f':	*ptr2++='f';	break;
-				case '\n':	*ptr2++='n';	break;
-				case '\r':	*ptr2++='r';	break;
-				case '\t':	*ptr2++='t';	break;
-				default:
-					sprintf(ptr2, "u%04x", token);
-					ptr2 += 5;
-					break;
+				c.entries.push_back(e);
+				return (false);
 			}
+			continue;
 		}
+		e.doc = c.arena.NewItem();
+		if (!e.doc || !e.doc->ParseInSituWithOpts(ptr, 0, true, &e.error))
+		{
+			if (!e.doc)
+				e.error.code = json_error_memory;
+			e.doc = 0;
+		}
+		c.entries.push_back(e);
 	}
-	*ptr2++  ='\"';
-	*ptr2++ = 0;
-	return (out);
+	if (c.end > c.begin && c.end[-1] != '\n')
+		--c.newlines;		// The last line has no end of line.
+	return (true);
 }
 
-char*			HandyJson::PrintString() const
+bool			HandyJsonLines::Claim(Run& run, size_t& k)
 {
-	return (this->PrintStringPtr(this->p_value_as_str));
+	std::unique_lock<std::mutex>	l(run.lock);
+
+	while (!run.stop && run.next + 1 < run.cuts.size() && run.window && run.next >= run.delivered + run.window)
+		run.claimable.wait(l);
+	if (run.stop || run.next + 1 >= run.cuts.size())
+		return (false);
+	k = run.next++;
+	return (true);
 }
 
-const char*		HandyJson::ParseValue(const char* value)
+void			HandyJsonLines::DomWorker(Run* run)
 {
-	if (!value)							return (0);
-    if (!strncmp(value, "null", 4))		{ this->p_type = json_null; return (value + 4); }
-    if (!strncmp(value, "false", 5))	{ this->p_type = json_false; return (value + 5); }
-    if (!strncmp(value, "true", 4))		{ this->p_type = json_true; this->p_value_as_int = 1; return (value + 4); }
-	if (*value == '\"')					{ return (this->ParseString(value)); }
-	if (*value == '-' || (*value >= '0' && *value <= '9')) { return (this->ParseNumber(value)); }
-	if (*value == '[')					{ return (this->ParseArray(value)); }
-	if (*value == '{')					{ return (this->ParseObject(value)); }
+	Chunk*		c;
+	size_t		k;
 
-	HandyJson::sp_err = value;
-	return (0);
+	while (HandyJsonLines::Claim(*run, k))
+	{
+		c = &run->slots[k % run->window];
+		c->begin = run->cuts[k];
+		c->end = run->cuts[k + 1];
+		HandyJsonLines::ParseChunk(*c, 0);
+		{
+			std::lock_guard<std::mutex>	l(run->lock);
+
+			c->done = true;
+		}
+		run->parsed.notify_all();
+	}
 }
 
-char*			HandyJson::PrintValue(int depth, int fmt) const
+void			HandyJsonLines::SaxWorker(Run* run, unsigned i)
 {
-	char*		out = 0;
-	switch (this->GetType())
+	Chunk&		c = run->slots[i];
+	size_t		k, line;
+	const char*	ptr;
+	HandyJsonError	error;
+
+	while (HandyJsonLines::Claim(*run, k))
 	{
-    case json_null	:		out = this->StrDup("null");	break;
-    case json_false	:		out = this->StrDup("false"); break;
-    case json_true	:		out = this->StrDup("true"); break;
-    case json_number	:		out = this->PrintNumber(); break;
-    case json_string	:		out = this->PrintString(); break;
-    case json_array	:		out = this->PrintArray(depth, fmt); break;
-    case json_object	:		out = this->PrintObject(depth, fmt); break;
+		c.begin = run->cuts[k];
+		c.end = run->cuts[k + 1];
+		c.entries.clear();
+		if (HandyJsonLines::ParseChunk(c, run->handlers[i]))
+			continue;
+		for (line = 1, ptr = run->data; (ptr = (const char*)memchr(ptr, '\n', c.begin - ptr)); ++ptr)
+			++line;		// Only counted on failure.
+		HandyJsonLines::SetError(*run, c.begin + c.entries.back().pos, line + c.entries.back().line, c.entries.back().error, error);
+		std::lock_guard<std::mutex>	l(run->lock);
+		if (!run->stop || error.offset < run->error.offset)
+			run->error = error;
+		run->stop = true;
+		return;
 	}
-	return (out);
 }
 
-const char*		HandyJson::ParseArray(const char* value)
+/* An error of one line, seen from the beginning of the data */
+void			HandyJsonLines::SetError(const Run& run, const char* line_ptr, size_t line, const HandyJsonError& e, HandyJsonError& out)
 {
-	HandyJson*	child;
+	out.code = e.code;
+	out.offset = (line_ptr - run.data) + e.offset;
+	out.line = line;
+	out.column = e.column;
+}
 
-	if (*value != '[')
-	{
-		HandyJson::sp_err = value;
-		return (0);
-	}
-    this->p_type = json_array;
-	value = this->Skip(value + 1);
-	if (*value == ']')
-		return (value + 1);
+bool			HandyJsonLines::Parse(const char* data, size_t size, HandyJsonLinesHandler& handler)
+{
+	Run							run;
+	std::vector<std::thread>	threads;
+	HandyJsonError				error;
+	Chunk*						c;
+	size_t						k, i, base = 1;
+	bool						ok = true;
 
-	this->p_child = child = new HandyJson();
-	if (!this->p_child)
-		return (0);
-	value = this->Skip(child->ParseValue(this->Skip(value)));
-	if (!value)
-		return (0);
-	while (*value == ',')
+	this->Cut(data, size, run);
+	run.window = this->p_window;
+	run.slots = new Chunk[run.window];
+	run.handlers = 0;
+	run.next = run.delivered = 0;
+	run.stop = false;
+	for (k = 0; k < run.window; ++k)
+		run.slots[k].done = false;
+	for (k = 0; k < this->p_threads && k + 1 < run.cuts.size(); ++k)
+		threads.push_back(std::thread(HandyJsonLines::DomWorker, &run));
+
+	/* Delivery, in order, on this thread */
+	for (k = 0; ok && k + 1 < run.cuts.size(); ++k)
 	{
-		HandyJson *new_item;
+		c = &run.slots[k % run.window];
+		{
+			std::unique_lock<std::mutex>	l(run.lock);
 
-		if (!(new_item = new HandyJson()))
-			return (0);
-		child->p_next = new_item;
-		new_item->p_prev = child;
-		child = new_item;
-		value = this->Skip(child->ParseValue(this->Skip(value + 1)));
-		if (!value)
-			return (0);
+			while (!c->done)
+				run.parsed.wait(l);
+		}
+		for (i = 0; ok && i < c->entries.size(); ++i)
+		{
+			const Chunk::Entry&	e = c->entries[i];
+
+			if (e.doc)
+				ok = handler.Document(e.doc, base + e.line);
+			else
+			{
+				HandyJsonLines::SetError(run, c->begin + e.pos, base + e.line, e.error, error);
+				ok = handler.Error(error);
+			}
+		}
+		base += c->newlines;
+		c->entries.clear();
+		c->arena.Reset();
+		{
+			std::lock_guard<std::mutex>	l(run.lock);
+
+			c->done = false;
+			run.delivered = k + 1;
+			run.stop = !ok;
+		}
+		run.claimable.notify_all();
 	}
-	if (*value == ']')
-		return (value + 1);
-	HandyJson::sp_err = value;
-	return (0);
+	for (k = 0; k < threads.size(); ++k)
+		threads[k].join();
+	delete[] (run.slots);
+	return (ok);
 }
 
-char*			HandyJson::PrintArray(int depth, int fmt) const
+bool			HandyJsonLines::ParseSax(const char* data, size_t size, HandyJsonHandler* const* handlers, unsigned count, HandyJsonError* error)
 {
-	char**		entries;
-	char*		out = 0, *ptr, *ret;
-	int			len = 5;
-	HandyJson*	child = this->GetChild();
-	int			numentries = 0, i = 0, fail = 0;
-	
-	while (child) ++numentries, child = child->p_next;
-	if (!numentries)
-	{
-		out = new char[3]();
-		if (out) strcpy(out, "[]");
-		out[2] = 0;
-		return (out);
-	}
-	entries = new char*[numentries * sizeof(char*)]();
-	if (!entries) return (0);
-	memset(entries, 0, numentries * sizeof(char*));
-	child = this->GetChild();
-	while (child && !fail)
-	{
-		ret = child->PrintValue(depth + 1, fmt);
-		entries[i++] = ret;
-		if (ret) len += strlen(ret) + 2 + (fmt ? 1 : 0);
-		else fail = 1;
-		child = child->GetNext();
-	}
-	if (!fail) out = new char[len]();
-	if (!out) fail = 1;
+	Run							run;
+	std::vector<std::thread>	threads;
+	unsigned					i;
 
-	if (fail)
-	{
-		for (i = 0; i < numentries; ++i) if (entries[i]) delete (entries[i]);
-		delete (entries);
-		return (0);
-	}
-	
-	*out = '[';
-	ptr = out + 1;
-	*ptr = 0;
-	for (i = 0; i < numentries; ++i)
+	if (!count)
+		return (false);
+	this->Cut(data, size, run);
+	run.window = 0;
+	run.slots = new Chunk[count];
+	run.handlers = handlers;
+	run.next = run.delivered = 0;
+	run.stop = false;
+	for (i = 1; i < count; ++i)
+		threads.push_back(std::thread(HandyJsonLines::SaxWorker, &run, i));
+	HandyJsonLines::SaxWorker(&run, 0);
+	for (i = 0; i < threads.size(); ++i)
+		threads[i].join();
+	delete[] (run.slots);
+	if (error)
 	{
-		strcpy(ptr, entries[i]);
-		ptr += strlen(entries[i]);
-		if (i != numentries - 1)
+		if (run.stop)
+			*error = run.error;
+		else
 		{
-			*ptr++ =',';
-			if (fmt)
-				*ptr++ = ' ';
-			*ptr = 0;
+			error->code = json_error_none;
+			error->offset = error->line = error->column = 0;
 		}
-		delete (entries[i]);
 	}
-	delete (entries);
-	*ptr++ = ']';
-	*ptr++ = 0;
-	return (out);
+	return (!run.stop);
 }
 
-const char*		HandyJson::ParseObject(const char* value)
+bool			HandyJsonLines::ParseFile(const char* path, HandyJsonLinesHandler& handler)
 {
-	HandyJson*	child;
+	HandyJsonFile	file;
+	HandyJsonError	error;
 
-	if (*value != '{')	{ HandyJson::sp_err = value; return (0); }
-	
-    this->p_type = json_object;
-	value = this->Skip(value + 1);
-	if (*value == '}')
-		return (value + 1);
-	
-	this->p_child = child = new HandyJson();
-	if (!this->GetChild()) return (0);
-	value = this->Skip(child->ParseString(this->Skip(value)));
-	if (!value)
-		return (0);
-	child->p_name = child->p_value_as_str;
-	child->p_value_as_str = 0;
-	if (*value!=':') { HandyJson::sp_err = value; return (0); }
-	value = this->Skip(child->ParseValue(this->Skip(value + 1)));
-	if (!value) 
-		return (0);
-	
-	while (*value==',')
+	if (!file.Open(path))
 	{
-		HandyJson *new_item;
-
-		if (!(new_item = new HandyJson())) return (0);
-		child->p_next = new_item;
-		new_item->p_prev = child;
-		child = new_item;
-		value = this->Skip(child->ParseValue(this->Skip(value + 1)));
-		if (!value)
-			return (0);
-		child->p_name = child->p_value_as_str;
-		child->p_value_as_str = 0;
-		if (*value!=':') { HandyJson::sp_err = value; return (0); }
-		value = this->Skip(child->ParseValue(this->Skip(value + 1)));
-		if (!value)
-			return (0);
+		error.code = json_error_file;
+		error.offset = error.line = error.column = 0;
+		handler.Error(error);
+		return (false);
 	}
-	
-	if (*value == '}')
-		return (value + 1);
-	HandyJson::sp_err = value;
-	return (0);
+	return (this->Parse(file.GetData(), file.GetSize(), handler));
 }
 
-char*			HandyJson::PrintObject(int depth, int fmt) const
+bool			HandyJsonLines::ParseSaxFile(const char* path, HandyJsonHandler* const* handlers, unsigned count, HandyJsonError* error)
 {
-	char**		entries = 0, **names = 0;
-	char*		out = 0, *ptr, *ret, *str;
-	int			len = 7, i = 0, j;
-	HandyJson*	child = this->GetChild();
-	int			numentries = 0, fail = 0;
+	HandyJsonFile	file;
 
-	while (child) numentries++, child = child->GetNext();
-	if (!numentries)
-	{
-		out = new char[fmt ? depth + 4 : 3]();
-		if (!out)
-			return (0);
-		ptr = out;
-		*ptr++ = '{';
-		if (fmt)
-		{ 
-			*ptr++ = '\n';
-			for (i = 0; i < depth - 1; ++i)
-				*ptr++ = '\t';
-		}
-		*ptr++ = '}';
-		*ptr++ = 0;
-		return (out);
-	}
-	entries = new char*[numentries * sizeof(char*)]();
-	if (!entries) return (0);
-	names = new char*[numentries * sizeof(char*)]();
-	if (!names)
-	{ 
-		delete (entries); 
-		return (0); 
-	}
-	memset(entries, 0, sizeof(char*) * numentries);
-	memset(names, 0, sizeof(char*) * numentries);
-	
-	child = this->GetChild();
-	++depth;
-	if (fmt)
-		len += depth;
-	while (child)
+	if (!file.Open(path))
 	{
-		names[i] = str = child->PrintStringPtr(child->GetName());
-		entries[i++] = ret = child->PrintValue(depth, fmt);
-		if (str && ret)
-			len += strlen(ret) + strlen(str) + 2 + (fmt ? 2 + depth : 0);
-		else
-			fail = 1;
-		child = child->GetNext();
+		if (error)
+		{
+			error->code = json_error_file;
+			error->offset = error->line = error->column = 0;
+		}
+		return (false);
 	}
-	
-	if (!fail) out = new char[len]();
-	if (!out) fail = 1;
+	return (this->ParseSax(file.GetData(), file.GetSize(), handlers, count, error));
+}
+#endif
+
+/*
+	+------------------+
+	| Scanning kernels |
+	+------------------+
+							*/
+static inline unsigned	FirstBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+	unsigned long	i;
+
+	_BitScanForward(&i, mask);
+	return ((unsigned)i);
+#else
+	return ((unsigned)__builtin_ctz(mask));
+#endif
+}
+
+bool			HandyJson::SelectKernels()
+{
+	const char*	(*skip)(const char*) = HandyJson::SkipScalar;
+	const char*	(*scan_str)(const char*) = HandyJson::ScanStringScalar;
+
+#if defined(HANDYJSON_SSE2)
+	skip = HandyJson::SkipSse2;
+	scan_str = HandyJson::ScanStringSse2;
+#endif
+#if defined(HANDYJSON_AVX2)
+	bool		avx2;
+# if defined(_MSC_VER)
+	int			info[4];
 
-	if (fail)
+	__cpuid(info, 0);
+	avx2 = false;
+	if (info[0] >= 7)
 	{
-		for (i = 0; i < numentries; ++i)
+		__cpuid(info, 1);
+		if ((info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6)		// OSXSAVE, and YMM state enabled by the OS.
 		{
-			if (names[i])
-				delete (names[i]);
-			if (entries[i])
-				delete (entries[i]);
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
 		}
-		delete (names);
-		delete (entries);
-		return (0);
 	}
-	
-	*out = '{';
-	ptr = out + 1;
-	if (fmt)
-		*ptr++ = '\n';
-	*ptr = 0;
-	for (i = 0; i< numentries; ++i)
-	{
-		if (fmt)
-			for (j = 0; j < depth; ++j)
-				*ptr++ = '\t';
-		strcpy(ptr, names[i]);
-		ptr += strlen(names[i]);
-		*ptr++ = ':';
-		if (fmt)
-			*ptr++ = '\t';
-		strcpy(ptr, entries[i]);
-		ptr += strlen(entries[i]);
-		if (i != numentries - 1)
-			*ptr++ = ',';
-		if (fmt)
-			*ptr++ = '\n';
-		*ptr = 0;
-		delete (names[i]);
-		delete (entries[i]);
+# else
+	__builtin_cpu_init();
+	avx2 = __builtin_cpu_supports("avx2") != 0;
+# endif
+	if (avx2)
+	{
+		skip = HandyJson::SkipAvx2;
+		scan_str = HandyJson::ScanStringAvx2;
 	}
-	
-	delete (names);
-	delete (entries);
-	if (fmt)
-		for (i = 0; i < depth - 1; ++i)
-			*ptr++ = '\t';
-	*ptr++ = '}';
-	*ptr++ = 0;
-	return (out);
+#endif
+	HandyJson::sp_skip = skip;
+	HandyJson::sp_scan_str = scan_str;
+	return (true);
 }
 
-void			HandyJson::SuffixItem(HandyJson* item)
+const char*		HandyJson::SkipScalar(const char* in)
 {
-	this->p_next = item;
-	item->p_prev = this;
+	while (*in && (unsigned char)*in <= 32)
+		in++;
+	return (in);
 }
 
-/* Some usefull functions */
-const char*		HandyJson::Skip(const char* in)
+const char*		HandyJson::ScanStringScalar(const char* in)
 {
-	while (in && *in && (unsigned char)*in <= 32)
+	while (*in && *in != '\"' && *in != '\\')
 		in++;
-	return in;
+	return (in);
 }
 
-int				HandyJson::StrCaseCmp(const char* s1, const char* s2)
+#if defined(HANDYJSON_SSE2)
+HANDYJSON_NO_SANITIZE
+const char*		HandyJson::SkipSse2(const char* in)
 {
-	if (!s1)
-		return ((s1 == s2) ? 0 : 1);
-	if (!s2)
-		return (1);
-	for	(; tolower(*s1) == tolower(*s2); ++s1, ++s2)
+	const __m128i	space = _mm_set1_epi8(32);
+	const __m128i	zero = _mm_setzero_si128();
+	__m128i			x;
+	unsigned		mask;
+
+	for (; (size_t)in & 15; ++in)		// Reach an aligned address: an aligned load never crosses a page.
+		if (!*in || (unsigned char)*in > 32)
+			return (in);
+	for (;; in += 16)
 	{
-		if (*s1 == 0)
-			return (0);
+		x = _mm_load_si128((const __m128i*)in);
+		x = _mm_andnot_si128(_mm_cmpeq_epi8(x, zero), _mm_cmpeq_epi8(_mm_max_epu8(x, space), space));
+		mask = ~(unsigned)_mm_movemask_epi8(x) & 0xFFFF;
+		if (mask)
+			return (in + FirstBit(mask));
 	}
-	return (tolower(*(const unsigned char *)s1) - tolower(*(const unsigned char *)s2));
 }
 
-char*			HandyJson::StrDup(const char* s)
+HANDYJSON_NO_SANITIZE
+const char*		HandyJson::ScanStringSse2(const char* in)
 {
-	size_t		len;
-    char*		copy;
+	const __m128i	quote = _mm_set1_epi8('\"');
+	const __m128i	slash = _mm_set1_epi8('\\');
+	const __m128i	zero = _mm_setzero_si128();
+	__m128i			x;
+	unsigned		mask;
 
-	if (!s)
-		return (0);
-    len = strlen(s) + 1;
-    if (!(copy = new char[len]()))
-		return (0);
-	memset(copy, 0, len);
-    memcpy(copy, s, len);
-    return (copy);
+	for (; (size_t)in & 15; ++in)
+		if (!*in || *in == '\"' || *in == '\\')
+			return (in);
+	for (;; in += 16)
+	{
+		x = _mm_load_si128((const __m128i*)in);
+		x = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, slash)), _mm_cmpeq_epi8(x, zero));
+		mask = (unsigned)_mm_movemask_epi8(x);
+		if (mask)
+			return (in + FirstBit(mask));
+	}
+}
+#else
+const char*		HandyJson::SkipSse2(const char* in)			{ return (HandyJson::SkipScalar(in)); }
+const char*		HandyJson::ScanStringSse2(const char* in)	{ return (HandyJson::ScanStringScalar(in)); }
+#endif
+
+#if defined(HANDYJSON_AVX2)
+HANDYJSON_NO_SANITIZE HANDYJSON_AVX2_TARGET
+const char*		HandyJson::SkipAvx2(const char* in)
+{
+	const __m256i	space = _mm256_set1_epi8(32);
+	const __m256i	zero = _mm256_setzero_si256();
+	__m256i			x;
+	unsigned		mask;
+
+	for (; (size_t)in & 31; ++in)
+		if (!*in || (unsigned char)*in > 32)
+			return (in);
+	for (;; in += 32)
+	{
+		x = _mm256_load_si256((const __m256i*)in);
+		x = _mm256_andnot_si256(_mm256_cmpeq_epi8(x, zero), _mm256_cmpeq_epi8(_mm256_max_epu8(x, space), space));
+		mask = ~(unsigned)_mm256_movemask_epi8(x);
+		if (mask)
+			return (in + FirstBit(mask));
+	}
+}
+
+HANDYJSON_NO_SANITIZE HANDYJSON_AVX2_TARGET
+const char*		HandyJson::ScanStringAvx2(const char* in)
+{
+	const __m256i	quote = _mm256_set1_epi8('\"');
+	const __m256i	slash = _mm256_set1_epi8('\\');
+	const __m256i	zero = _mm256_setzero_si256();
+	__m256i			x;
+	unsigned		mask;
+
+	for (; (size_t)in & 31; ++in)
+		if (!*in || *in == '\"' || *in == '\\')
+			return (in);
+	for (;; in += 32)
+	{
+		x = _mm256_load_si256((const __m256i*)in);
+		x = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, slash)), _mm256_cmpeq_epi8(x, zero));
+		mask = (unsigned)_mm256_movemask_epi8(x);
+		if (mask)
+			return (in + FirstBit(mask));
+	}
 }
+#else
+const char*		HandyJson::SkipAvx2(const char* in)			{ return (HandyJson::SkipSse2(in)); }
+const char*		HandyJson::ScanStringAvx2(const char* in)	{ return (HandyJson::ScanStringSse2(in)); }
+#endif
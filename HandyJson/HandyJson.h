@@ -36,6 +36,26 @@
 #include	<math.h>
 #include	<float.h>
 #include	<limits.h>
+#include	<stdint.h>
+#include	<new>
+#include	<iosfwd>
+
+#if !defined(HANDYJSON_NO_THREADS) && (__cplusplus >= 201103L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L))
+# define	HANDYJSON_THREADS		// C++11 threads, for HandyJsonLines.
+#endif
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+# define	HANDYJSON_THREAD_LOCAL	thread_local
+#elif defined(_MSC_VER)
+# define	HANDYJSON_THREAD_LOCAL	__declspec(thread)
+#else
+# define	HANDYJSON_THREAD_LOCAL	__thread
+#endif
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+# define	HANDYJSON_MOVE			// C++11 move constructor and assignment, for HandyJson.
+# define	HANDYJSON_BINDING		// C++11 templates of HandyJsonBind.h.
+#endif
 
 enum	eTypes
 {
@@ -48,58 +68,485 @@ enum	eTypes
     json_object		=	6
 };
 
+enum	eErrors
+{
+	json_error_none		=	0,		// No error.
+	json_error_value	=	1,		// Not a valid value.
+	json_error_string	=	2,		// Unterminated string, or bad escape sequence.
+	json_error_key		=	3,		// An object name is not a string.
+	json_error_colon	=	4,		// Missing ':' after an object name.
+	json_error_array	=	5,		// Missing ',' or ']' in an array.
+	json_error_object	=	6,		// Missing ',' or '}' in an object.
+	json_error_depth	=	7,		// Nesting deeper than HandyJson::GetMaxDepth().
+	json_error_trailing	=	8,		// Data after the value, when a null terminated value is required.
+	json_error_handler	=	9,		// An event handler stopped the parse.
+	json_error_memory	=	10,		// Out of memory.
+	json_error_file		=	11,		// The file can not be read.
+	json_error_type		=	12		// A value does not fit what HandyJsonReader was asked to read.
+};
+
+/*
+	Where and why a parse failed. Each parse fills its own, so threads never
+	share error state.
+*/
+struct		HandyJsonError
+{
+	eErrors				code;			// json_error_none after a success.
+	size_t				offset;			// Offset of the failure in the data, in bytes.
+	size_t				line;			// Line of the failure, from 1 (0 for binary data).
+	size_t				column;			// Column of the failure in bytes, from 1 (0 for binary data).
+};
+
+class		HandyJson;
+
+/*
+	HandyJsonArena is an optional document arena. Every item, name and string value
+	built through an arena item comes out of large contiguous blocks, and the whole
+	tree is freed at once by Release() (or by the arena destructor), or by Reset()
+	to parse the next document in the same memory.
+	Items from an arena must not be mixed with heap items in the same tree.
+*/
+class		HandyJsonArena
+{
+private:
+	struct	Block
+	{
+		Block*			next;
+		size_t			size;
+	};
+
+private:
+	Block*				p_blocks;			// Blocks list, most recent first.
+	char*				p_ptr;				// Next free byte in the current block.
+	char*				p_end;				// End of the current block.
+	size_t				p_block_size;		// Default size of a new block.
+
+public:
+	HandyJsonArena(size_t block_size = 64 * 1024);
+	~HandyJsonArena(void);
+
+public:
+	void*				Alloc(size_t, size_t align = sizeof(void*));	// Get raw memory from the arena.
+	char*				AllocStr(size_t);								// Get memory for a string (no alignment).
+	char*				StrDup(const char*);							// Copy a string in the arena.
+	HandyJson*			NewItem();										// Build a fresh HandyJson item in the arena.
+	void				Release();										// Free every block at once.
+	void				Reset();										// Same, but keep a block for the next document.
+
+private:
+	bool				Grow(size_t);
+
+private:
+	HandyJsonArena(const HandyJsonArena&);
+	HandyJsonArena&		operator=(const HandyJsonArena&);
+};
+
+/*
+	HandyJsonKeyPool keeps one copy of each object member name. Given to a parse or
+	to a HandyJsonBuilder, it holds the names of the items built: equal names share
+	one string, which lookups compare by pointer before comparing characters, and
+	whose hash the key indexes do not compute again. A pool may serve one document
+	or many, one thread at a time, and must outlive every tree using its names.
+*/
+class		HandyJsonKeyPool
+{
+	friend class		HandyJson;			// Reads the hash kept before each name.
+
+private:
+	struct	Slot
+	{
+		const char*		key;				// The name, after its key index hash.
+		uint32_t		hash;				// Hash of the exact bytes, for the pool.
+		uint32_t		len;				// Length of the name.
+	};
+
+private:
+	HandyJsonArena		p_strings;			// The names.
+	Slot*				p_slots;			// Open addressing table of the names, at most half full.
+	size_t				p_mask;				// Slots count - 1, a power of two.
+	size_t				p_count;			// Names in the pool.
+
+public:
+	HandyJsonKeyPool(void);
+	~HandyJsonKeyPool(void);
+
+public:
+	const char*			Intern(const char*, size_t);	// The pooled copy of a name, added if new (0 if out of memory).
+	const char*			Intern(const char*);			// Same, zero terminated: lookups with it compare pointers.
+	size_t				GetCount() const	{ return (this->p_count); }	// Names in the pool.
+	void				Clear();						// Forget every name, the trees using them must be gone.
+
+private:
+	bool				Grow();
+	static uint32_t		Hash(const char*, size_t);
+	static uint32_t		GetHash(const char* key)	{ return (((const uint32_t*)key)[-1]); }	// HandyJson::HashName() of a name.
+
+private:
+	HandyJsonKeyPool(const HandyJsonKeyPool&);
+	HandyJsonKeyPool&	operator=(const HandyJsonKeyPool&);
+};
+
+/*
+	HandyJsonHandler receives the events of HandyJson::ParseSax(). Override the events
+	you need, every event returns true to continue and false to stop the parse.
+	Strings and keys are given as a pointer and a length: they are not zero terminated
+	and are only valid during the call.
+*/
+class		HandyJsonHandler
+{
+public:
+	virtual ~HandyJsonHandler(void) {}
+
+public:
+	virtual bool		StartObject()					{ return (true); }	//
+	virtual bool		EndObject()						{ return (true); }	//
+	virtual bool		StartArray()					{ return (true); }	//
+	virtual bool		EndArray()						{ return (true); }	// Parsing events.
+	virtual bool		Key(const char*, size_t)		{ return (true); }	//
+	virtual bool		String(const char*, size_t)		{ return (true); }	//
+	virtual bool		Number(double)					{ return (true); }	//
+	virtual bool		Bool(bool)						{ return (true); }	//
+	virtual bool		Null()							{ return (true); }	//
+
+	/* Integers fitting in 64 bits come through those events, by default forwarded to Number() */
+	virtual bool		Int64(int64_t i)				{ return (this->Number((double)i)); }
+	virtual bool		UInt64(uint64_t u)				{ return (this->Number((double)u)); }	// Only above INT64_MAX.
+};
+
+/*
+	HandyJsonSink receives the output of a HandyJsonWriter, a buffer at a time.
+	The sinks below write to a FILE*, a file descriptor, a std::ostream or a
+	callback; derive from it for anything else.
+*/
+class		HandyJsonSink
+{
+public:
+	virtual ~HandyJsonSink(void) {}
+
+public:
+	virtual bool		Write(const char*, size_t) = 0;		// Take the bytes, false to stop the writer.
+};
+
+class		HandyJsonFileSink : public HandyJsonSink
+{
+private:
+	FILE*				p_file;
+
+public:
+	HandyJsonFileSink(FILE* file) : p_file(file) {}
+
+public:
+	virtual bool		Write(const char*, size_t);
+};
+
+class		HandyJsonFdSink : public HandyJsonSink
+{
+private:
+	int					p_fd;
+
+public:
+	HandyJsonFdSink(int fd) : p_fd(fd) {}
+
+public:
+	virtual bool		Write(const char*, size_t);		// Retries short writes.
+};
+
+class		HandyJsonStreamSink : public HandyJsonSink
+{
+private:
+	std::ostream*		p_stream;
+
+public:
+	HandyJsonStreamSink(std::ostream& stream) : p_stream(&stream) {}
+
+public:
+	virtual bool		Write(const char*, size_t);
+};
+
+class		HandyJsonCallbackSink : public HandyJsonSink
+{
+private:
+	bool				(*p_callback)(void*, const char*, size_t);
+	void*				p_user;
+
+public:
+	HandyJsonCallbackSink(bool (*callback)(void*, const char*, size_t), void* user) : p_callback(callback), p_user(user) {}
+
+public:
+	virtual bool		Write(const char* data, size_t size)	{ return (this->p_callback(this->p_user, data, size)); }
+};
+
+/*
+	HandyJsonFile maps a whole file in memory, followed by a zero byte, so that
+	the parsers read it in place with no copy. The mapping is read only, unless
+	opened writable: it is then private to the process (copy on write), to be
+	given to HandyJson::ParseInSitu(), and must outlive the tree.
+	Files which can not be mapped (pipes, special files) are read in a buffer.
+*/
+class		HandyJsonFile
+{
+private:
+	char*				p_data;				// The file content, followed by a zero.
+	size_t				p_size;				// Size of the file.
+	size_t				p_map_size;			// Size of the mapping, 0 if p_data is a heap buffer.
+
+public:
+	HandyJsonFile(void);
+	~HandyJsonFile(void);
+
+public:
+	bool				Open(const char*, bool writable = false);	// Map a file, false if it can not be read.
+	void				Close();									// Unmap it.
+	char*				GetData() const		{ return (this->p_data); }	// The zero terminated content.
+	size_t				GetSize() const		{ return (this->p_size); }	// Its size, without the zero.
+
+private:
+	bool				Map(const char*, bool);
+	bool				Read(const char*);
+
+private:
+	HandyJsonFile(const HandyJsonFile&);
+	HandyJsonFile&		operator=(const HandyJsonFile&);
+};
+
 class		HandyJson
 {
+	friend class		HandyJsonPush;		// Shares the tokenizing functions.
+	friend class		HandyJsonBuilder;	// Fills items like the parser does.
+	friend class		HandyJsonLazy;		//
+	friend class		HandyJsonLazyItem;	// Read values like the parser does.
+	friend class		HandyJsonTape;		//
+	friend class		HandyJsonTapeItem;	// Keep numbers exactly.
+	friend class		HandyJsonPath;		// Looks names up with their hash known.
+	friend class		HandyJsonWriter;	// Shares the number formatting.
+	friend class		HandyJsonKeyPool;	// Hashes names like the key indexes.
+	friend class		HandyJsonReader;	// Shares the tokenizing functions.
+
 	/* Json types */	
 private:
-	static const char*			sp_err;
+	static HANDYJSON_THREAD_LOCAL const char*	sp_err;
+	static size_t				sp_max_depth;
 	static const unsigned char	sp_firstByteMark[7];
+	static const uint64_t		sp_pow5_128[2 * (308 + 342 + 1)];
+	static const double			sp_pow10[23];
+	static const uint64_t		sp_cached_pow_f[87];
+	static const short			sp_cached_pow_e[87];
+	static const char			sp_digit_pairs[200];
+
+	/* Ownership flags */
+	enum	eFlags
+	{
+		flag_name_ref	=	0x01,		// The name points into a buffer the item does not own.
+		flag_str_ref	=	0x02,		// The string points into a buffer the item does not own.
+		flag_int		=	0x04,		// The number is an integer held exactly by p_value.i.
+		flag_uint		=	0x08,		// The integer is above INT64_MAX, p_value.i holds it as an uint64_t.
+		flag_name_in	=	0x10,		// The name is short, and kept inside the item.
+		flag_str_in		=	0x20,		// Same for the string.
+		flag_name_pool	=	0x40		// The name comes from a HandyJsonKeyPool (with flag_name_ref).
+	};
+
+	/* A string, kept inside the item when it is short */
+	union	Str
+	{
+		struct
+		{
+			char*			ptr;		// Allocated, or referenced (see the ref flags).
+			unsigned int	len;		// Length, without the terminating zero.
+		}					out;
+		char				in[16];		// Up to 15 bytes. in[15] holds 15 minus the length: full, it is the terminating zero.
+	};
+
+	/* Both indexes of a container, in one block made with the first of them */
+	struct	Indexes;
+
+	/* The children of an array or an object */
+	struct	Children
+	{
+		HandyJson*			first;		// Its p_prev is the last child, which saves a tail pointer.
+		Indexes*			indexes;	// Built by the non-const lookups, or BuildIndexes().
+	};
+
+	/* The value: the type tells which member is used, and the flags how */
+	union	Value
+	{
+		Str				str;			// json_string.
+		int64_t			i;				// json_number with flag_int, and 1 for a true.
+		double			d;				// json_number otherwise.
+		Children		kids;			// json_array and json_object.
+	};
+
+	/* A number, as read by ScanNumber() */
+	struct	NumberValue
+	{
+		double			dbl;			// Nearest double, always set.
+		uint64_t		bits;			// The integer, if is_int (an int64_t unless is_uint).
+		bool			is_int;			// Integer syntax, and it fits in 64 bits.
+		bool			is_uint;		// Only fits in an uint64_t.
+	};
+
+	/* Error state of one parse */
+	struct	ErrorContext
+	{
+		const char*		start;			// Beginning of the data.
+		const char*		where;			// Failure position, or null.
+		eErrors			code;			// Failure reason.
+	};
+
+	/* State shared by the parsing functions during one parse */
+	struct	ParseContext : ErrorContext
+	{
+		bool			in_situ;		// Strings are decoded inside the input buffer.
+		HandyJsonKeyPool*	keys;		// Holds the names, if any.
+		HandyJson**		stack;			// Containers being filled, the innermost last.
+		size_t			stack_size;		// Size of stack.
+		size_t			max_depth;		// Deepest nesting accepted.
+	};
+
+	/* State shared by the event parsing functions during one parse */
+	struct	SaxContext : ErrorContext
+	{
+		HandyJsonHandler*	handler;	// Receives the events.
+		char*				scratch;	// Decoding buffer for escaped strings, reused all along the parse.
+		size_t				size;		// Size of scratch.
+		char*				stack;		// Open containers, '[' or '{', the innermost last.
+		size_t				stack_size;	// Size of stack.
+		size_t				max_depth;	// Deepest nesting accepted.
+	};
+
+	/* State shared by the binary decoding functions during one parse */
+	struct	BinaryContext : ErrorContext
+	{
+		struct	Level
+		{
+			uint64_t	left;			// Values still to come, pairs for a map.
+			bool		map;			// Map or array.
+			bool		key;			// A key comes next.
+			bool		open;			// Indefinite length, ended by a break (CBOR).
+		};
+
+		HandyJsonHandler*	handler;	// Receives the events.
+		const char*			end;		// End of the data.
+		char*				scratch;	// Joins the chunks of indefinite length CBOR strings.
+		size_t				size;		// Size of scratch.
+		Level*				stack;		// Open containers, the innermost last.
+		size_t				depth;		// Levels in stack.
+		size_t				stack_size;	// Size of stack.
+		size_t				max_depth;	// Deepest nesting accepted.
+	};
+
+	/* Case insensitive hash table of the children of an object, by name */
+	struct	KeyIndex;
+
+	/* Contiguous table of the children of an array or an object, by position */
+	struct	ItemIndex
+	{
+		HandyJson**		items;			// The children in order.
+		size_t			cap;			// Size of items, the count is p_size.
+	};
 
 private:
-    eTypes	p_type;				// The type of the node (Look above).
-	char*				p_name;				// The name of the node. Needed if the node is to be inserted in an object.
 	HandyJson*			p_next;				// The following node.
-	HandyJson*			p_prev;				// The previous node.
-	HandyJson*			p_child;			// If type is json_array or json_object, there will be a child.
-	char*				p_value_as_str;		// Value, if type is json_string.
-	int					p_value_as_int;		// Value, if type is json_number.
-	double				p_value_as_dbl;		// Value, if type is json_number.
+	HandyJson*			p_prev;				// The previous node, or the last one for a first child.
+	HandyJsonArena*		p_arena;			// The arena owning this item, if any.
+	Str					p_name;				// The name of the node. Needed if the node is to be inserted in an object.
+	Value				p_value;			// The value of the node, or its children.
+	unsigned int		p_size;				// Number of children.
+	unsigned char		p_type;				// The type of the node (Look above).
+	unsigned char		p_flags;			// Ownership flags (Look above).
 
 public:
 	HandyJson(void);
     HandyJson(eTypes);
-	HandyJson(const HandyJson&);
+	HandyJson(HandyJsonArena*);			// An item whose children and strings will live in the arena.
+	HandyJson(const HandyJson&);		// A deep copy, on the heap: nothing is shared with the original.
+#ifdef HANDYJSON_MOVE
+	HandyJson(HandyJson&&) noexcept;	// Takes the value and the children over, the original is left a null.
+#endif
 	~HandyJson(void);
 
+public:
+	/*
+		Assignments replace the value and the children of an item, which keeps
+		its name and its place in its parent. Moving between two arenas, or an
+		arena and the heap, copies instead. The source may be a child of the
+		item, but not one of its parents.
+	*/
+	HandyJson&			operator=(const HandyJson&);
+#ifdef HANDYJSON_MOVE
+	HandyJson&			operator=(HandyJson&&);
+#endif
+
 public:
 	/* Basics getters */														//
-    eTypes	GetType() const		{ return (this->p_type); }			//
-	const char*			GetName() const		{ return (this->p_name); }			// Get stuff.
-	HandyJson*			GetNext() const		{ return (this->p_next); }			//
-	HandyJson*			GetPrev() const		{ return (this->p_prev); }			//
-	HandyJson*			GetChild() const	{ return (this->p_child); }			//
-	char*				GetValStr() const	{ return (this->p_value_as_str); }	//
-	int					GetValInt() const	{ return (this->p_value_as_int); }	//
-	double				GetValDbl() const	{ return (this->p_value_as_dbl); }	//
+    eTypes	GetType() const		{ return ((eTypes)this->p_type); }	//
+	const char*			GetName() const		{ return (StrData(this->p_name, this->p_flags & flag_name_in)); }	//
+	HandyJson*			GetNext() const		{ return (this->p_next); }			// Get stuff.
+	HandyJson*			GetPrev() const		{ return (this->p_prev && this->p_prev->p_next == this ? this->p_prev : 0); }
+	HandyJson*			GetChild() const	{ return (this->p_type >= json_array ? this->p_value.kids.first : 0); }
+	HandyJsonArena*		GetArena() const	{ return (this->p_arena); }			//
+	char*				GetValStr() const	{ return (this->p_type == json_string ? StrData(this->p_value.str, this->p_flags & flag_str_in) : 0); }
+	size_t				GetNameLen() const	{ return (StrLen(this->p_name, this->p_flags & flag_name_in)); }	//
+	size_t				GetValStrLen() const{ return (this->p_type == json_string ? StrLen(this->p_value.str, this->p_flags & flag_str_in) : 0); }
+	int					GetValInt() const	{ return ((int)this->GetValInt64()); }	//
+	int64_t				GetValInt64() const;									//
+	uint64_t			GetValUInt64() const;									//
+	double				GetValDbl() const;										//
 
 public:
 	/* Basics setters */
 	bool				SetName(const char*);		//
 	bool				SetValStr(const char*);		// Set stuff.
 	bool				SetValInt(int);				//
+	bool				SetValInt64(int64_t);		//
+	bool				SetValUInt64(uint64_t);		//
 	bool				SetValDbl(double);			//
 
 public:
 	/* Main functions */
 	bool				Parse(const char*);								// Build a HandyJson tree from a const char*.
-	bool				ParseWithOpts(const char*, const char**, bool);	
+	bool				ParseWithOpts(const char*, const char**, bool, HandyJsonError* = 0, HandyJsonKeyPool* = 0);	// Names from the pool, if given.
+	bool				ParseInSitu(char*);								// Same than Parse() but strings are decoded inside the buffer,
+	bool				ParseInSituWithOpts(char*, char**, bool, HandyJsonError* = 0, HandyJsonKeyPool* = 0);	// which is modified and must outlive the tree.
+	bool				ParseFile(const char*, HandyJsonError* = 0);	// Same than Parse() on a mapped file. Use the HandyJsonError
+																		// rather than GetErrorPtr(), the file is unmapped on return.
+	static bool			ParseSax(const char*, HandyJsonHandler&);		// Fire handler events from a const char*, without building any item.
+	static bool			ParseSaxWithOpts(const char*, HandyJsonHandler&, const char**, bool, HandyJsonError* = 0);
 	char*				Print();										// Build a char* from a HandyJson tree.
 	char*				PrintUnformated();								// Same than Print() but does not format the output.
+	bool				Print(HandyJsonSink&) const;					// Same than Print() and PrintUnformated(), streamed
+	bool				PrintUnformated(HandyJsonSink&) const;			// to a sink through a HandyJsonWriter buffer.
+	bool				Fire(HandyJsonHandler&) const;					// Give the tree to a handler, as ParseSax() does with text.
 
-	/* Handling functions */
+	/*
+		Binary formats, for the same trees: MessagePack and CBOR (RFC 8949). The Print
+		functions give a new[] buffer and its size. The Parse functions read a span in
+		place, with no zero at the end: without a size_t*, the value must fill the span,
+		with one, data may follow and the size of the value is given back. Binary
+		strings become strings, and CBOR tags are skipped.
+	*/
+	char*				PrintMsgPack(size_t&) const;											//
+	char*				PrintCbor(size_t&) const;												//
+	bool				ParseMsgPack(const void*, size_t, size_t* = 0, HandyJsonError* = 0);	// Build a tree.
+	bool				ParseCbor(const void*, size_t, size_t* = 0, HandyJsonError* = 0);		//
+	static bool			ParseMsgPackSax(const void*, size_t, HandyJsonHandler&, size_t* = 0, HandyJsonError* = 0);	// Fire handler
+	static bool			ParseCborSax(const void*, size_t, HandyJsonHandler&, size_t* = 0, HandyJsonError* = 0);	// events.
+
+	/*
+		Handling functions. Objects with many children get a hash index of their names,
+		built by the first slow GetObjectItem() and kept up to date by the functions below.
+		Renaming a child with SetName() is not seen by the index: detach the child first.
+		In the same way, GetArrayItem() past the first children builds a table of the
+		children positions, so that indexed loops over large arrays stay linear.
+		Only the non-const lookups build indexes, the const ones use those which exist:
+		any number of threads may read a tree through const references at once, as long
+		as none modifies it. Call BuildIndexes() before sharing a large tree that way.
+	*/
 	HandyJson*			GetObjectItem(const char*) const;				// Get an item in an object, using its name.
+	HandyJson*			GetObjectItem(const char*);						// Same, and may index the object.
+	void				BuildIndexes();									// Index the large containers of the tree.
 	int					GetArraySize() const;							// Get the size of an array.
 	HandyJson*			GetArrayItem(int) const;						// Get an item in an array, using index.
+	HandyJson*			GetArrayItem(int);								// Same, and may index the array.
 	bool				AddItemToArray(HandyJson*);						// Push back an item in an array.
 	bool				AddItemToObject(const char*, HandyJson*);		// Push back an item in an object.
 	HandyJson*			DetachItemFromArray(int);						// Detach an item from an array, using index.
@@ -108,13 +555,15 @@ public:
 	void				DeleteItemFromObject(const char*);				// Delete an item from an object, using its name.
 	void				ReplaceItemInArray(int, HandyJson*);			// Replace an item in an array, using index.
 	void				ReplaceItemInObject(const char*, HandyJson*);	// Replace an item in an object, using its name.
-	HandyJson*			Duplicate(bool);								// Duplicate the HandyJson value.
+	HandyJson*			Duplicate(bool);								// Duplicate the HandyJson value (always on the heap).
 
 	/* Types functions */
 	void				BuildInNull();					//
 	void				BuildInTrue();					// Those fuctions are used to specify a node-type
 	void				BuildInFalse();					// to a fresh and new HandyJson item.
 	void				BuildInNumber(double);			//
+	void				BuildInInt64(int64_t);			//
+	void				BuildInUInt64(uint64_t);		//
 	void				BuildInString(const char*);		// By default a HandyJson item is BuildInObject().
 	void				BuildInArray();					//
 	void				BuildInObject();				//
@@ -125,8 +574,13 @@ public:
 	void				BuildInDblArray(const double*, int);	// building easier and faster.
 	void				BuildInStrArray(const char**, int);		//
 
-	/* Error function */
-	const char*			GetErrorPtr();	// This function is used to get the sp_err value which may be set after a fail.
+	/* Error functions */
+	const char*			GetErrorPtr();					// Failure position of the last parse of the calling thread.
+	static const char*	GetErrorText(eErrors);			// Describe an error code, the WithOpts functions give the full HandyJsonError.
+
+	/* Parsing limits, shared by every parse */
+	static void			SetMaxDepth(size_t);	// Nesting deeper than this fails the parse (HANDYJSON_MAX_DEPTH by default).
+	static size_t		GetMaxDepth();			// The parsers do not recurse, deep data only costs heap memory.
 
 private:
 	/*
@@ -135,28 +589,787 @@ private:
 		+--------------------+
 								*/
 	/* Parsing functions */
-	const char*			ParseValue(const char*);	//
-	const char*			ParseNumber(const char*);	// Those functions are used to parse a JSON data
-	const char*			ParseString(const char*);	// and build a HandyJson structure. They all are
-	const char*			ParseArray(const char*);	// called by the public function Parse().
-	const char*			ParseObject(const char*);	//
-	unsigned			ParseHex4(const char*);		//
+	bool				ParseRoot(const char*, const char**, bool, ParseContext&, HandyJsonError*);	//
+	const char*			ParseValue(const char*, ParseContext&);						// Those functions are used to parse a JSON data
+	const char*			ParseChild(const char*, HandyJson*&, ParseContext&);		// and build a HandyJson structure. They all are
+	const char*			ParseNumber(const char*);									// called by the public function Parse().
+	const char*			ParseString(const char*, ParseContext&);					//
+	const char*			ParseKey(const char*, ParseContext&);						//
+
+	/* Event parsing functions */
+	static const char*	SaxValue(const char*, SaxContext&);			// Those functions are used to parse a JSON data
+	static const char*	SaxString(const char*, SaxContext&, bool);	// and fire the handler events. They all are
+	static const char*	SaxScalar(const char*, SaxContext&);		// called by the public function ParseSax().
+
+	/* Error handling functions */
+	static const char*	Fail(ErrorContext&, const char*, eErrors);								// Record a failure, return null.
+	static bool			Finish(ErrorContext&, const char*, const char**, bool, HandyJsonError*);	// Check the end, report errors.
+
+	/* Tokenizing functions */
+	static const char*	ScanNumber(const char*, NumberValue&);		//
+	static bool			EiselLemire(int64_t, uint64_t, double&);	// Those functions are shared by the item
+	static double		SlowNumber(const char*, const char*);		// building parser and the event parser.
+	static size_t		StringLength(const char*);					//
+	static const char*	DecodeString(const char*, char*&);			//
+	static unsigned		ParseHex4(const char*);						//
 
 	/* Printing functions */
-	char*				PrintValue(int, int) const;			//
-	char*				PrintNumber() const;				// Those functions are used to build a JSON data
-	char*				PrintString() const;				// using de HandyJson structure. They all are
-	char*				PrintStringPtr(const char*) const;	// called by the public function Print().
-	char*				PrintArray(int, int) const;			//
-	char*				PrintObject(int, int) const;		//
+	struct				PrintBuffer;
+	char*				PrintToString(int) const;							//
+	bool				PrintValue(PrintBuffer&, int, int) const;			// Those functions are used to build a JSON data
+	bool				PrintNumber(PrintBuffer&) const;					// using de HandyJson structure. They all write
+	bool				PrintStringPtr(PrintBuffer&, const char*) const;	// in the same buffer and are called by the
+	bool				PrintArray(PrintBuffer&, int, int) const;			// public function Print().
+	bool				PrintObject(PrintBuffer&, int, int) const;			//
+
+	/* Binary format functions */
+	bool				EncodeBinary(PrintBuffer&, bool) const;		// Those functions are used to write and read
+	bool				EncodeMsgPack(PrintBuffer&) const;			// MessagePack and CBOR, a value or the head of
+	bool				EncodeCbor(PrintBuffer&) const;				// a container at a time. Decoding fires handler
+	static const char*	DecodeMsgPack(const char*, BinaryContext&);	// events, like ParseSax() does.
+	static const char*	DecodeCbor(const char*, BinaryContext&);	//
+	static const char*	CborString(const char*, const char*, unsigned char, uint64_t, bool, BinaryContext&, const char*&, size_t&);
+	static bool			Push(BinaryContext&, const char*, uint64_t, bool, bool);	// Open a container.
+	static bool			Pop(BinaryContext&, const char*);							// Count a value, close what it completes.
+	static bool			ParseBinary(const void*, size_t, HandyJsonHandler&, bool, size_t*, HandyJsonError*);
+
+	/* Number formatting functions */
+	struct				DiyFp;
+	static char*		WriteUInt64(char*, uint64_t);									// Those functions write a number
+	static char*		WriteDouble(char*, double);										// and return the end of the output.
+	static void			Grisu2(double, char*, int&, int&);								// Shortest digits which read back
+	static void			DigitGen(const DiyFp&, const DiyFp&, uint64_t, char*, int&, int&);	// to the same double.
+
+	void				SetNumber(const NumberValue&);	// Used by ParseNumber() and the number setters.
+
+	/* Linking functions */
+	void				SuffixItem(HandyJson*);						// Used to make some links between items.
+	void				AppendChild(HandyJson*);					// Link an item after the last child.
+	HandyJson*			DetachItem(HandyJson*, int);				// Unlink a child, at the given position if known (or -1).
+	void				ReplaceItem(HandyJson*, HandyJson*, int);	// Put an item in place of a child, and delete the child.
+	void				ResetChildren();							// Forget the children, before a parse.
 
-	/* Linking function */
-	void				SuffixItem(HandyJson*);	// Used to make some links between items.
+	/* Key index functions */
+	static uint32_t		HashName(const char*, size_t = (size_t)-1);	//
+	uint32_t			NameHash() const;							//
+	HandyJson*			IndexFind(const char*, uint32_t) const;		// Those functions maintain the key hash
+	HandyJson*			FindItem(const char*, uint32_t) const;		// index of the children of an object. Any
+	HandyJson*			WalkItem(const char*, int&) const;			// change they can not follow cheaply drops
+	void				IndexBuild();								// the index, which is built again later.
+	void				IndexAdd(HandyJson*, bool);					//
+	void				IndexRemove(HandyJson*);					//
+	void				IndexDrop();								//
+	void				ItemsBuild();					//
+	void				ItemsPush(HandyJson*);			// Same for the item index.
+	void				ItemsRemove(HandyJson*, int);	//
+	void				ItemsDrop();					//
+
+	/* Allocation functions */
+	HandyJson*			NewItem() const;			//
+	char*				AllocStr(size_t) const;		// Those functions allocate from the arena
+	char*				CopyStr(const char*, size_t) const;	// of the item if it has one, and from the
+	bool				AssignName(const char*);	// heap otherwise. Free functions only release
+	bool				AssignValStr(const char*);	// what the item owns.
+	void				FreeName();					//
+	void				FreeValStr();				//
+	void				TakeNameFromValStr();		// Used by ParseChild() to turn a parsed string into a name.
+	bool				StoreStr(Str&, unsigned char, const char*, size_t);	// Copy a string in the item, if it is short.
+	bool				PoolName(HandyJsonKeyPool&, const char*, size_t);	// Take the name from a pool.
+	static char*		StrData(const Str& s, int in)	{ return (in ? const_cast<char*>(s.in) : s.out.ptr); }
+	static size_t		StrLen(const Str& s, int in)	{ return (in ? 15 - (unsigned char)s.in[15] : s.out.len); }
+	void				SetType(eTypes);			// Change the type, and drop the value if it does not fit the new one.
+	KeyIndex*			Keys() const;				// The indexes of a container,
+	ItemIndex*			Items() const;				// or 0 while they are not built.
+	Indexes*			MakeIndexes();				// Used by IndexBuild() and ItemsBuild().
+	void				FreeIndexes();				// Used by IndexDrop() and ItemsDrop().
+
+	/* Copy functions */
+	bool				CopyFrom(const HandyJson&, bool);	// Copy a value, and its children if asked, into a fresh item.
+	void				TakeFrom(HandyJson&);				// Move a value and its children into an empty item.
+	void				ClearValue();						// Free the value and the children, keep the name.
 
 private:
 	/* Some usefull functions */
 	static const char*			Skip(const char*);
+	static const char*			ScanString(const char*);	// Find the next quote, backslash or end of data.
 	static int					StrCaseCmp(const char*, const char*);
 	static char*				StrDup(const char*);
+
+private:
+	/*
+		Scanning kernels, picked depending on the CPU during static initialization,
+		before any thread can parse: the pointers are never written afterwards.
+		Parses run by static constructors of other files may still get the scalar ones.
+	*/
+	static const char*			(*sp_skip)(const char*);
+	static const char*			(*sp_scan_str)(const char*);
+	static const bool			sp_kernels;		// Set by SelectKernels().
+	static bool					SelectKernels();
+	static const char*			SkipScalar(const char*);
+	static const char*			ScanStringScalar(const char*);
+	static const char*			SkipSse2(const char*);
+	static const char*			ScanStringSse2(const char*);
+	static const char*			SkipAvx2(const char*);
+	static const char*			ScanStringAvx2(const char*);
+};
+
+/*
+	HandyJsonPush parses a value given in chunks, as they come from a socket or a pipe,
+	and fires the events of a HandyJsonHandler as soon as each token is complete: only
+	a token cut by the end of a chunk is copied, to be finished by the next chunk.
+	Give the chunks to Feed() until IsDone() or IsFailed(), and call Finish() at the
+	end of the data, which a number alone needs to know it is complete. Feed() returns
+	how much of the chunk it used: the rest belongs to the next value, after Reset().
+	Error offsets and lines count from the first Feed(), across Reset().
+*/
+class		HandyJsonPush
+{
+private:
+	/* What the grammar accepts next */
+	enum	eExpect
+	{
+		expect_value,				// Any value.
+		expect_value_or_close,		// A value or ']', after '['.
+		expect_key,					// A name, after ',' in an object.
+		expect_key_or_close,		// A name or '}', after '{'.
+		expect_colon,				// ':' after a name.
+		expect_comma_or_close,		// ',' or the end of the container, after a value.
+		expect_nothing				// The value is complete, or failed.
+	};
+
+	/* Token being read, maybe across chunks */
+	enum	eToken
+	{
+		token_none,
+		token_key,
+		token_string,
+		token_number,
+		token_true,
+		token_false,
+		token_null
+	};
+
+private:
+	HandyJsonHandler*	p_handler;			// Receives the events.
+	eExpect				p_expect;			// Next grammar step.
+	eToken				p_token;			// Token being read.
+	unsigned char		p_escape;			// Bytes of an escape still to read in the string (5 for the letter).
+	bool				p_escaped;			// The string has escapes, it is decoded from p_buf.
+	const char*			p_literal;			// Rest of the literal being read.
+	char*				p_buf;				// Bytes of the token from the previous chunks.
+	size_t				p_buf_len;			// Bytes in p_buf.
+	size_t				p_buf_size;			// Size of p_buf.
+	char*				p_stack;			// Open containers, '[' or '{', the innermost last.
+	size_t				p_depth;			// Containers in p_stack.
+	size_t				p_stack_size;		// Size of p_stack.
+	const char*			p_chunk;			// The chunk given to Feed().
+	size_t				p_offset;			// Offset of p_chunk in the data.
+	size_t				p_line;				// Current line, from 1.
+	size_t				p_line_offset;		// Offset of its beginning.
+	size_t				p_token_offset;		// Offset of the token,
+	size_t				p_token_line;		// and its line and column, in case
+	size_t				p_token_column;		// the token spans an end of line.
+	HandyJsonError		p_error;			// json_error_none unless the value failed.
+
+public:
+	HandyJsonPush(HandyJsonHandler&);
+	~HandyJsonPush(void);
+
+public:
+	size_t				Feed(const char*, size_t);	// Parse a chunk, return the bytes used.
+	bool				Finish();					// End of the data, false if the value is not complete.
+	void				Reset();					// Parse the next value.
+	bool				IsDone() const		{ return (this->p_expect == expect_nothing && !this->IsFailed()); }
+	bool				IsFailed() const	{ return (this->p_error.code != json_error_none); }
+	const HandyJsonError&	GetError() const	{ return (this->p_error); }
+
+private:
+	size_t				Pos(const char* ptr) const	{ return (this->p_offset + (ptr - this->p_chunk)); }
+	const char*			Skip(const char*, const char*);						// Skip whitespaces, count the lines.
+	const char*			Step(const char*, const char*);						// One grammar step.
+	const char*			Token(const char*, const char*, const char*);		// Read a token, maybe begun in p_buf.
+	bool				EndString(const char*, size_t);						//
+	bool				EndNumber(const char*, size_t&);					// Fire the events of a whole token.
+	bool				EndLiteral();										//
+	const char*			Open(const char*);									//
+	const char*			Close(const char*);									// Containers.
+	const char*			AfterValue(const char*);							// Next step after a value.
+	eErrors				AfterValueError() const;							// Error of a bad byte after a value.
+	bool				Keep(const char*, size_t);							// Append to p_buf.
+	const char*			Fail(size_t, eErrors);								// Record a failure, return null.
+
+private:
+	HandyJsonPush(const HandyJsonPush&);
+	HandyJsonPush&		operator=(const HandyJsonPush&);
+};
+
+/*
+	HandyJsonBuilder builds a tree out of events, from HandyJsonPush or from any other
+	event source, in the given root item and in its arena if it has one, taking the
+	names from the pool if one is given. Reset() before building the next tree in
+	the same root.
+*/
+class		HandyJsonBuilder : public HandyJsonHandler
+{
+private:
+	HandyJson*			p_root;				// The tree.
+	HandyJson**			p_stack;			// Containers being filled, the innermost last.
+	size_t				p_depth;			// Containers in p_stack.
+	size_t				p_stack_size;		// Size of p_stack.
+	HandyJson*			p_item;				// Child named by the last Key(), waiting for its value.
+	bool				p_started;			// The root got its value.
+	HandyJsonKeyPool*	p_keys;				// Holds the names, if any.
+
+public:
+	HandyJsonBuilder(HandyJson&, HandyJsonKeyPool* = 0);
+	~HandyJsonBuilder(void);
+
+public:
+	void				Reset();
+
+public:
+	virtual bool		StartObject();					//
+	virtual bool		EndObject();					//
+	virtual bool		StartArray();					//
+	virtual bool		EndArray();						//
+	virtual bool		Key(const char*, size_t);		// Building events.
+	virtual bool		String(const char*, size_t);	//
+	virtual bool		Number(double);					//
+	virtual bool		Int64(int64_t);					//
+	virtual bool		UInt64(uint64_t);				//
+	virtual bool		Bool(bool);						//
+	virtual bool		Null();							//
+
+private:
+	HandyJson*			Next();					// Item of the next value.
+	bool				Start(eTypes);			// Begin a container.
+
+private:
+	HandyJsonBuilder(const HandyJsonBuilder&);
+	HandyJsonBuilder&	operator=(const HandyJsonBuilder&);
+};
+
+/*
+	HandyJsonReader pulls one value out of JSON text a token at a time, for code
+	which knows the shape of what it reads: open the containers, take the names
+	and the values in order, skip what is not wanted. Nothing is built.
+	A read which does not match the data fails the whole read, json_error_type
+	for a value of another type, and every later read fails as well: check the
+	outcome once, with Finish(). Values are read with the leniency of HandyJson::Parse().
+	Names and strings come as a pointer and a length, not always zero terminated,
+	and are only valid until the next read.
+	HandyJsonBind.h uses it to fill C++ structures.
+*/
+class		HandyJsonReader
+{
+private:
+	HandyJson::SaxContext	p_ctx;			// Error state, decoding buffer, and the stack of SkipValue().
+	HandyJsonHandler		p_skip;			// Ignores the events of skipped values.
+	const char*				p_ptr;			// Next byte to read, null after a failure.
+	const char*				p_value;		// The last value read, where Fail() points.
+	size_t					p_depth;		// Open containers.
+	bool					p_first;		// Nothing read yet in the innermost container.
+
+public:
+	HandyJsonReader(const char*);
+	~HandyJsonReader(void);
+
+public:
+	bool				StartObject();							//
+	bool				NextKey(const char*&, size_t&);			// Containers. The Next functions return false at
+	bool				StartArray();							// the end, which closes the container, or on failure.
+	bool				NextItem();								//
+	bool				Peek(eTypes&);							// Type of the next value, false if it is not one.
+	bool				ReadNull();								// True if the next value is null, which is read then.
+	bool				ReadBool(bool&);						//
+	bool				ReadInt64(int64_t&);					// Integers only take integer syntax,
+	bool				ReadUInt64(uint64_t&);					// in the range of their type.
+	bool				ReadDouble(double&);					//
+	bool				ReadString(const char*&, size_t&);		//
+	bool				ReadTree(HandyJson&, HandyJsonKeyPool* = 0);	// The whole value, names from the pool if given.
+	bool				SkipValue();							//
+	bool				Fail(eErrors = json_error_type);		// Fail the read at the last value, for the checks of the caller.
+	bool				IsFailed() const	{ return (this->p_ptr == 0); }
+	bool				Finish(const char** = 0, bool = false, HandyJsonError* = 0);	// After the value, as HandyJson::ParseWithOpts().
+
+private:
+	const char*			Value();								// Start of the next value, null after a failure.
+	bool				Mismatch();								// Fail at a value of another type, or at no value.
+	bool				Number(HandyJson::NumberValue&);		// The next number.
+	bool				Open(const char*);						// Enter a container.
+	bool				Close(const char*);						// Leave one, return false.
+	bool				Fail(const char*, eErrors);				// Record a failure, return false.
+	const char*			String(const char*, const char*&, size_t&);	// Decode a string if it has escapes.
+
+private:
+	HandyJsonReader(const HandyJsonReader&);
+	HandyJsonReader&	operator=(const HandyJsonReader&);
+};
+
+class		HandyJsonLazy;
+
+/*
+	HandyJsonLazyItem is a value of a HandyJsonLazy document: a position in the data,
+	cheap to copy. Children are found by skipping their elder siblings, whole arrays
+	and objects at once, and numbers and strings are only decoded when read.
+	An item which does not exist (missing name, index past the end) is not valid,
+	and reads as a null with no children.
+*/
+class		HandyJsonLazyItem
+{
+	friend class		HandyJsonLazy;
+
+private:
+	const HandyJsonLazy*	p_doc;			// The document.
+	const char*				p_ptr;			// The value in the data, null if not valid.
+	const char*				p_name;			// Its name in an object (at the quote), or null.
+	size_t					p_ord;			// Rank of the first array or object from p_ptr, in the document index.
+	char					p_parent;		// '[' or '{' for a child, 0 for the root.
+
+public:
+	HandyJsonLazyItem(void);
+
+public:
+	bool				IsValid() const		{ return (this->p_ptr != 0); }
+	eTypes				GetType() const;								//
+	const char*			GetName() const;								// Get stuff, as HandyJson does.
+	const char*			GetValStr() const;								// Names and strings are decoded
+	int					GetValInt() const;								// in the document arena, at each call.
+	int64_t				GetValInt64() const;							//
+	uint64_t			GetValUInt64() const;							//
+	double				GetValDbl() const;								//
+	HandyJsonLazyItem	GetChild() const;								//
+	HandyJsonLazyItem	GetNext() const;								//
+	HandyJsonLazyItem	GetObjectItem(const char*) const;				// Get an item in an object, using its name.
+	int					GetArraySize() const;							// Count the children.
+	HandyJsonLazyItem	GetArrayItem(int) const;						// Get an item in an array, using index.
+	bool				Build(HandyJson&, HandyJsonError* = 0) const;	// Parse the whole value in a tree.
+
+private:
+	HandyJsonLazyItem(const HandyJsonLazy*, const char*, const char*, size_t, char);
+	HandyJsonLazyItem	Child(const char*, size_t, char) const;	// The child at the given position, after its name.
+	const char*			End(size_t&) const;						// First byte after the value.
+	bool				NameIs(const char*) const;				// Case insensitive, as HandyJson::GetObjectItem().
+	void				ReadNumber(HandyJson&) const;			// Numeric value, as the parser sets it.
+	const char*			Decode(const char*) const;				// A string, in the arena.
+};
+
+/*
+	HandyJsonLazy reads a document on demand. Parse() makes one pass over the data
+	which only checks that strings, arrays and objects are closed, and indexes where
+	each array and object ends. The items then navigate the data in place: nothing
+	is built for what is not read. Values are read with the leniency of HandyJson::Parse().
+	The data must be zero terminated, and stay unchanged while the document is used.
+*/
+class		HandyJsonLazy
+{
+	friend class		HandyJsonLazyItem;
+
+private:
+	/* An array or an object, by rank of its opening in the data */
+	struct	Container
+	{
+		size_t			close;				// Offset of its closing bracket.
+		size_t			after;				// Rank of the first array or object after it.
+	};
+
+private:
+	const char*				p_data;			// The document, null until parsed.
+	Container*				p_index;		// Every array and object of the root value.
+	size_t					p_count;		// Entries in p_index.
+	size_t					p_size;			// Size of p_index.
+	mutable HandyJsonArena	p_arena;		// Decoded names and strings.
+
+public:
+	HandyJsonLazy(void);
+	~HandyJsonLazy(void);
+
+public:
+	bool				Parse(const char*, HandyJsonError* = 0);	// Check and index the structure.
+	HandyJsonLazyItem	GetRoot() const;							// The root value, not valid if the parse failed.
+
+private:
+	static const char*	SkipString(const char*);	// Closing quote of a string, or end of data.
+
+private:
+	HandyJsonLazy(const HandyJsonLazy&);
+	HandyJsonLazy&		operator=(const HandyJsonLazy&);
+};
+
+class		HandyJsonTape;
+
+/*
+	HandyJsonTapeItem is a value of a HandyJsonTape: an entry of the tape, cheap to copy.
+	An item which does not exist (missing name, index past the end) is not valid,
+	and reads as a null with no children.
+*/
+class		HandyJsonTapeItem
+{
+	friend class		HandyJsonTape;
+
+private:
+	const HandyJsonTape*	p_tape;			// The document, null if not valid.
+	size_t					p_index;		// Entry of the value.
+	size_t					p_end;			// Entry after its parent, where its siblings stop.
+
+public:
+	HandyJsonTapeItem(void);
+
+public:
+	bool				IsValid() const		{ return (this->p_tape != 0); }
+	eTypes				GetType() const;								//
+	const char*			GetName() const;								//
+	size_t				GetNameLen() const;								//
+	const char*			GetValStr() const;								// Get stuff, as HandyJson does.
+	size_t				GetValStrLen() const;							//
+	int					GetValInt() const;								//
+	int64_t				GetValInt64() const;							//
+	uint64_t			GetValUInt64() const;							//
+	double				GetValDbl() const;								//
+	HandyJsonTapeItem	GetChild() const;								//
+	HandyJsonTapeItem	GetNext() const;								//
+	HandyJsonTapeItem	GetObjectItem(const char*) const;				// Get an item in an object, using its name.
+	int					GetArraySize() const;							// Get the size of an array (or an object).
+	HandyJsonTapeItem	GetArrayItem(int) const;						// Get an item in an array, using index.
+	bool				Build(HandyJson&) const;						// Copy the value in a tree.
+	bool				Fire(HandyJsonHandler&) const;					// Give the value to a handler, as ParseSax() does.
+
+private:
+	HandyJsonTapeItem(const HandyJsonTape*, size_t, size_t);
+	size_t				Next() const;					// Entry after the value.
+	void				ReadNumber(HandyJson&) const;	// Numeric value, as the parser sets it.
+};
+
+/*
+	HandyJsonTape is an immutable document held in one array of entries, in document
+	order: each value is followed by its children, and each array or object knows the
+	entry after its last descendant, so a sibling is reached in one step. Names and
+	strings sit in one separate buffer. Reading it walks memory in order, where a tree
+	chases pointers from node to node.
+	Build it from text with Parse(), or from a tree with Load(). Get a tree back with
+	GetRoot().Build().
+*/
+class		HandyJsonTape : private HandyJsonHandler
+{
+	friend class		HandyJsonTapeItem;
+
+private:
+	/* Number representation */
+	enum	eFlags
+	{
+		flag_int		=	0x01,		// value holds an int64_t.
+		flag_uint		=	0x02		// value holds an uint64_t above INT64_MAX.
+	};
+
+	/* One value */
+	struct	Entry
+	{
+		uint64_t		value;			// Number (int64_t, uint64_t or double bits), string offset, or entry after a container.
+		uint64_t		size;			// Length of a string, or children of a container.
+		uint64_t		name;			// Offset of the name in the strings, 0 for none.
+		uint32_t		name_len;		// Length of the name.
+		unsigned char	type;			// eTypes.
+		unsigned char	flags;			// eFlags, for a number.
+	};
+
+private:
+	Entry*				p_entries;			// The tape.
+	size_t				p_count;			// Entries in p_entries.
+	size_t				p_size;				// Size of p_entries.
+	char*				p_strings;			// Names and strings, each zero terminated, after one unused byte.
+	size_t				p_len;				// Bytes in p_strings.
+	size_t				p_cap;				// Size of p_strings.
+	size_t*				p_stack;			// Containers being written, the innermost last.
+	size_t				p_depth;			// Containers in p_stack.
+	size_t				p_stack_size;		// Size of p_stack.
+	uint64_t			p_name;				// Name of the next entry, 0 for none.
+	uint32_t			p_name_len;			// Its length.
+
+public:
+	HandyJsonTape(void);
+	~HandyJsonTape(void);
+
+public:
+	bool				Parse(const char*, HandyJsonError* = 0);	// Build the tape from JSON data.
+	bool				Load(const HandyJson&);						// Build the tape from a tree.
+	void				Clear();									// Empty the tape, keep its memory.
+	HandyJsonTapeItem	GetRoot() const;							// The root value, not valid if the tape is empty.
+
+private:
+	Entry*				Add(eTypes);								// Append an entry, named by p_name.
+	bool				AddString(const char*, size_t, uint64_t&);	// Append to p_strings, give the offset.
+	bool				Open(eTypes);								// Append an array or an object.
+	bool				Close();									// End the innermost one.
+
+private:
+	/* Events of Parse() */
+	virtual bool		StartObject();					//
+	virtual bool		EndObject();					//
+	virtual bool		StartArray();					//
+	virtual bool		EndArray();						//
+	virtual bool		Key(const char*, size_t);		// Writing events.
+	virtual bool		String(const char*, size_t);	//
+	virtual bool		Number(double);					//
+	virtual bool		Int64(int64_t);					//
+	virtual bool		UInt64(uint64_t);				//
+	virtual bool		Bool(bool);						//
+	virtual bool		Null();							//
+
+private:
+	HandyJsonTape(const HandyJsonTape&);
+	HandyJsonTape&		operator=(const HandyJsonTape&);
+};
+
+/*
+	HandyJsonPath is a query compiled once, to be run on many documents. It accepts
+	a JSON Pointer (RFC 6901), as "/store/book/0/title", or a path starting with '$':
+		.name or ['name']	a child of an object ("name" may also be quoted, \ escapes the quote)
+		[2] or [-1]			an item of an array, negative counting from the end
+		[1:3], [:2], [-2:]	the items of an array in [begin, end), as a slice
+		.* or [*]			every child of an array or an object
+	Names compare as GetObjectItem() does, and their hash is computed once, at Compile().
+*/
+class		HandyJsonPath
+{
+	friend class		HandyJsonPathFilter;
+
+private:
+	/* What a step selects */
+	enum	eSteps
+	{
+		step_name		=	0,		// The child of an object with that name.
+		step_member		=	1,		// A pointer token: the child of an object by name, or of an array by index.
+		step_index		=	2,		// The item of an array at begin.
+		step_slice		=	3,		// The items of an array in [begin, end).
+		step_any		=	4		// Every child.
+	};
+
+	/* One step of the query */
+	struct	Step
+	{
+		const char*		name;			// Zero terminated, in p_names.
+		size_t			name_len;		// Length of name.
+		uint32_t		hash;			// HandyJson::HashName() of name.
+		int64_t			begin;			// Index, or start of a slice. Negative counts from the end.
+		int64_t			end;			// End of a slice, INT64_MAX if open.
+		eSteps			type;			// What it selects.
+	};
+
+private:
+	Step*				p_steps;			// The steps, from the root.
+	size_t				p_count;			// Steps in p_steps.
+	char*				p_names;			// Decoded names of the steps.
+
+public:
+	HandyJsonPath(void);
+	~HandyJsonPath(void);
+
+public:
+	bool				Compile(const char*);									// Read a pointer or a path, false if it is malformed.
+	HandyJson*			Find(const HandyJson&) const;							// The first match in document order, or null.
+	size_t				FindAll(const HandyJson&, HandyJson**, size_t) const;	// Count the matches, keep the first ones in the array.
+	size_t				GetStepCount() const	{ return (this->p_count); }		// 0 selects the root itself.
+
+private:
+	void				Clear();
+	bool				CompilePointer(const char*);		// Those functions fill p_steps from the two syntaxes.
+	bool				CompilePath(const char*);			//
+	bool				Collect(const HandyJson*, size_t, HandyJson**, size_t, size_t&, bool) const;	// Match step n and the next ones.
+	bool				Selects(const Step&, const char*, size_t, size_t, bool) const;					// Step check for a child met in order.
+
+private:
+	HandyJsonPath(const HandyJsonPath&);
+	HandyJsonPath&		operator=(const HandyJsonPath&);
+};
+
+/*
+	HandyJsonPathFilter runs a HandyJsonPath on the events of a parse, and gives the
+	events of the matched values only to another handler: give it to ParseSax(),
+	HandyJsonPush or HandyJsonLines to query data which is never built as a tree.
+	Each value is seen once, when it goes by, so negative indexes and slice bounds,
+	which need the size of the array, select nothing. Where a name appears twice,
+	both values match, where GetObjectItem() finds the first one.
+*/
+class		HandyJsonPathFilter : public HandyJsonHandler
+{
+private:
+	/* An open container */
+	struct	Frame
+	{
+		size_t			index;			// Position of its next child.
+		bool			is_array;		// Array or object.
+		bool			matched;		// It matches the first steps of the path, so its children may too.
+	};
+
+private:
+	const HandyJsonPath*	p_path;		// The query.
+	HandyJsonHandler*	p_handler;			// Receives the matched values.
+	Frame*				p_stack;			// Containers open outside the matches, the innermost last.
+	size_t				p_depth;			// Frames in p_stack.
+	size_t				p_stack_size;		// Size of p_stack.
+	size_t				p_inside;			// Containers open inside the match being given, 0 if none.
+	bool				p_key_match;		// The last Key() selects its value.
+	size_t				p_matches;			// Values given.
+
+public:
+	HandyJsonPathFilter(const HandyJsonPath&, HandyJsonHandler&);
+	~HandyJsonPathFilter(void);
+
+public:
+	void				Reset();									// Before another document.
+	size_t				GetMatchCount() const	{ return (this->p_matches); }
+
+public:
+	virtual bool		StartObject();					//
+	virtual bool		EndObject();					//
+	virtual bool		StartArray();					//
+	virtual bool		EndArray();						//
+	virtual bool		Key(const char*, size_t);		// Filtering events.
+	virtual bool		String(const char*, size_t);	//
+	virtual bool		Number(double);					//
+	virtual bool		Int64(int64_t);					//
+	virtual bool		UInt64(uint64_t);				//
+	virtual bool		Bool(bool);						//
+	virtual bool		Null();							//
+
+private:
+	int					Enter(eTypes);		// A value starts: 1 if it is a match, 0 if not, -1 on failure.
+	bool				Leave();			// A container ends, outside of the matches.
+
+private:
+	HandyJsonPathFilter(const HandyJsonPathFilter&);
+	HandyJsonPathFilter&	operator=(const HandyJsonPathFilter&);
+};
+
+/*
+	HandyJsonWriter writes JSON text from events, to a sink, through a buffer of
+	fixed size: the output is never held whole, whatever its size. Call the events
+	by hand to write a document with no tree, or give the writer to any parser or
+	to HandyJson::Fire(). Formatted output is the same as HandyJson::Print().
+	Values written after a complete document go on their own lines.
+*/
+class		HandyJsonWriter : public HandyJsonHandler
+{
+private:
+	/* An open container */
+	struct	Level
+	{
+		bool			object;			// Object or array.
+		bool			empty;			// Nothing written in it yet.
+	};
+
+private:
+	HandyJsonSink*		p_sink;				// Receives the output.
+	char*				p_buf;				// The buffer.
+	size_t				p_len;				// Bytes waiting in p_buf.
+	size_t				p_size;				// Size of p_buf.
+	Level*				p_stack;			// Open containers, the innermost last.
+	size_t				p_depth;			// Levels in p_stack.
+	size_t				p_stack_size;		// Size of p_stack.
+	bool				p_formatted;		// Tabs and new lines, as Print().
+	bool				p_key;				// A key was written, its value comes next.
+	bool				p_started;			// A value was written at the root.
+	bool				p_failed;			// The sink refused data, or an event came out of place.
+
+public:
+	HandyJsonWriter(HandyJsonSink&, bool formatted = false, size_t buffer = 0);	// A buffer of 0 takes the default size.
+	~HandyJsonWriter(void);														// Flushes.
+
+public:
+	bool				Flush();							// Give the buffer to the sink.
+	void				Reset();							// Start again, after a failure.
+	bool				IsFailed() const	{ return (this->p_failed); }
+	bool				Key(const char* str)		{ return (this->Key(str, strlen(str))); }		// For zero
+	bool				String(const char* str)		{ return (this->String(str, strlen(str))); }	// terminated strings.
+
+public:
+	virtual bool		StartObject();					//
+	virtual bool		EndObject();					//
+	virtual bool		StartArray();					//
+	virtual bool		EndArray();						//
+	virtual bool		Key(const char*, size_t);		// Writing events.
+	virtual bool		String(const char*, size_t);	//
+	virtual bool		Number(double);					//
+	virtual bool		Int64(int64_t);					//
+	virtual bool		UInt64(uint64_t);				//
+	virtual bool		Bool(bool);						//
+	virtual bool		Null();							//
+
+private:
+	bool				Value();						// Separator before a value, false if none may come.
+	bool				Open(bool);						// Start an object or an array.
+	bool				Close(bool);					// End one.
+	bool				Put(const char*, size_t);		// Buffered output.
+	bool				PutEscaped(const char*, size_t);	// A quoted string.
+	bool				PutTabs(size_t);				//
+	char*				Reserve(size_t);				// Room for a number, flushing first if needed.
+
+private:
+	HandyJsonWriter(const HandyJsonWriter&);
+	HandyJsonWriter&	operator=(const HandyJsonWriter&);
+};
+
+#ifdef HANDYJSON_THREADS
+
+/*
+	HandyJsonLinesHandler receives the documents of HandyJsonLines::Parse(), in input
+	order, on the calling thread. A document lives in an arena and in a copy of its
+	line: it is only valid during the call (Duplicate() it to keep it).
+	Both functions return true to continue and false to stop the parse.
+*/
+class		HandyJsonLinesHandler
+{
+public:
+	virtual ~HandyJsonLinesHandler(void) {}
+
+public:
+	virtual bool		Document(HandyJson*, size_t)		{ return (true); }	// A document and its line, from 1.
+	virtual bool		Error(const HandyJsonError&)		{ return (false); }	// A line which does not parse, offset and line
+};																				// count from the beginning of the data.
+
+/*
+	HandyJsonLines parses newline delimited JSON (NDJSON, JSON Lines) on several
+	threads. The data is cut in chunks at ends of lines, each chunk is copied with
+	its lines zero terminated and parsed in situ, in an arena, by the first free
+	thread. Blank lines are skipped.
+*/
+class		HandyJsonLines
+{
+private:
+	struct	Chunk;
+	struct	Run;
+
+private:
+	unsigned			p_threads;			// Parsing threads.
+	size_t				p_chunk_size;		// Bytes per chunk, extended to the next end of line.
+	unsigned			p_window;			// Chunks parsed ahead of the handler, at most.
+
+public:
+	HandyJsonLines(unsigned threads = 0);	// Defaults to one thread per core.
+
+public:
+	void				SetChunkSize(size_t size)	{ this->p_chunk_size = size ? size : 1; }
+	void				SetWindow(unsigned window)	{ this->p_window = window ? window : 1; }
+
+	/* Documents in input order, at most a window of chunks in memory */
+	bool				Parse(const char*, size_t, HandyJsonLinesHandler&);
+	bool				ParseFile(const char*, HandyJsonLinesHandler&);
+
+	/*
+		Events, with one handler per thread: each handler gets whole lines, in order
+		within a chunk, but the chunks are spread over the threads. The first error
+		or handler refusal stops every thread.
+	*/
+	bool				ParseSax(const char*, size_t, HandyJsonHandler* const*, unsigned, HandyJsonError* = 0);
+	bool				ParseSaxFile(const char*, HandyJsonHandler* const*, unsigned, HandyJsonError* = 0);
+
+private:
+	void				Cut(const char*, size_t, Run&) const;								// Chunk boundaries.
+	static bool			ParseChunk(Chunk&, HandyJsonHandler*);								// Split and parse the lines.
+	static bool			Claim(Run&, size_t&);												// Next chunk for a thread.
+	static void			DomWorker(Run*);													//
+	static void			SaxWorker(Run*, unsigned);											// Threads bodies.
+	static void			SetError(const Run&, const char*, size_t, const HandyJsonError&, HandyJsonError&);
 };
 
+#endif
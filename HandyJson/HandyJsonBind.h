@@ -0,0 +1,368 @@
+/*
+  Copyright (c) 2014 Pascal "Relax" Assens
+ 
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+ 
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+ 
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+/*
+	Purpose :
+	Reads JSON text straight into C++ structures, through HandyJsonReader: no tree
+	is built. Declare the members of a structure once, at global scope:
+
+		struct	Trade { std::string symbol; double price; int64_t qty; std::vector<std::string> tags; };
+
+		HANDYJSON_BIND(Trade,
+			HANDYJSON_FIELD(symbol),
+			HANDYJSON_FIELD(price),
+			HANDYJSON_FIELD_NAMED(qty, "quantity"),
+			HANDYJSON_FIELD(tags))
+
+	then HandyJsonBind::Read(json, trade). Members may be bool, integers, float,
+	double, std::string, std::vector of any of those, HandyJson (the value as a tree)
+	and other bound structures. Specialize HandyJsonBindValue for any other type.
+	Names are matched as HandyJson::GetObjectItem() does, ignoring the case of ASCII
+	letters. Unknown names are skipped, missing ones and null values leave the
+	member as it was. Needs C++11.
+*/
+
+#pragma once
+
+#include	<string>
+#include	<vector>
+#include	<limits>
+#include	<type_traits>
+#include	"HandyJson.h"
+
+#ifndef HANDYJSON_BINDING
+# error "HandyJsonBind.h needs C++11."
+#endif
+
+template <class T>			struct	HandyJsonBindField;
+template <size_t N>			struct	HandyJsonBindOrder;
+template <size_t... K>		struct	HandyJsonBindSeq {};		// The indexes 0 to N - 1, from HandyJsonBindMakeSeq<N>::type.
+template <class T>			struct	HandyJsonBinding;			// Made by HANDYJSON_BIND for each bound structure.
+template <class T, class = void>	struct	HandyJsonBindValue;	// How a member of type T is read.
+
+/*
+	HandyJsonBind reads a value into a variable. The structures bound by
+	HANDYJSON_BIND have their member names hashed, and sorted by hash, at
+	compile time: a name is first compared with the member after the last one
+	read, which is right when the data keeps the declaration order, and
+	otherwise found by a binary search on its hash. Sorting costs the compiler
+	O(n^3) steps for n members, nothing at run time.
+*/
+class		HandyJsonBind
+{
+public:
+	template <class T> static bool		Read(const char*, T&, HandyJsonError* = 0);								// As HandyJson::Parse().
+	template <class T> static bool		ReadWithOpts(const char*, T&, const char**, bool, HandyJsonError* = 0);	// As HandyJson::ParseWithOpts().
+	template <class T> static bool		ReadValue(HandyJsonReader&, T&);		// The next value of a reader, for HandyJsonBindValue.
+	template <class T> static bool		ReadObject(HandyJsonReader&, T&);		// The members of a bound structure.
+	template <class T, class M, M T::*member>
+	static bool							ReadMember(HandyJsonReader& reader, T& object)	{ return (HandyJsonBind::ReadValue(reader, object.*member)); }
+
+public:
+	/* Name functions, for the tables made by HANDYJSON_BIND */
+	static constexpr char		Lower(char c)		{ return (c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c); }
+	static constexpr uint32_t	Hash(const char* name, size_t len, uint32_t hash = 2166136261u)		// FNV-1a, of the lower case.
+	{
+		return (len ? HandyJsonBind::Hash(name + 1, len - 1, (hash ^ (unsigned char)HandyJsonBind::Lower(*name)) * 16777619u) : hash);
+	}
+	static uint32_t				HashKey(const char* key, size_t len)		// Same hash, for the names read.
+	{
+		uint32_t	hash = 2166136261u;
+
+		for (; len; --len, ++key)
+			hash = (hash ^ (unsigned char)HandyJsonBind::Lower(*key)) * 16777619u;
+		return (hash);
+	}
+	static bool					Equal(const char* name, const char* key, size_t len)
+	{
+		if (!memcmp(name, key, len))
+			return (true);
+		for (; len; --len, ++name, ++key)
+			if (HandyJsonBind::Lower(*name) != HandyJsonBind::Lower(*key))
+				return (false);
+		return (true);
+	}
+
+	/* Sorting the members by hash, equal ones in declaration order */
+	template <class F> static constexpr bool	Before(const F* f, size_t a, size_t b)	{ return (f[a].hash < f[b].hash || (f[a].hash == f[b].hash && a < b)); }
+	template <class F> static constexpr size_t	Rank(const F* f, size_t n, size_t a, size_t b = 0)		// Members before f[a].
+	{
+		return (b == n ? 0 : HandyJsonBind::Before(f, b, a) + HandyJsonBind::Rank(f, n, a, b + 1));
+	}
+	template <class F> static constexpr size_t	Sorted(const F* f, size_t n, size_t k, size_t a = 0)	// The member of rank k.
+	{
+		return (HandyJsonBind::Rank(f, n, a) == k ? a : HandyJsonBind::Sorted(f, n, k, a + 1));
+	}
+	template <class F, size_t... K>
+	static constexpr HandyJsonBindOrder<sizeof...(K)>	Order(const F* f, HandyJsonBindSeq<K...>)
+	{
+		return (HandyJsonBindOrder<sizeof...(K)>{ { HandyJsonBind::Sorted(f, sizeof...(K), K)... } });
+	}
+};
+
+/* A member of a bound structure, its name and how to read it */
+template <class T>
+struct		HandyJsonBindField
+{
+	const char*			name;
+	size_t				len;
+	uint32_t			hash;
+	bool				(*read)(HandyJsonReader&, T&);
+
+	constexpr HandyJsonBindField(const char* n, size_t l, bool (*r)(HandyJsonReader&, T&)) :
+		name(n), len(l), hash(HandyJsonBind::Hash(n, l)), read(r) {}
+};
+
+/* The indexes of the members of a bound structure, by increasing hash */
+template <size_t N>
+struct		HandyJsonBindOrder
+{
+	size_t				index[N];
+};
+
+template <size_t N, size_t... K>	struct	HandyJsonBindMakeSeq : HandyJsonBindMakeSeq<N - 1, N - 1, K...> {};
+template <size_t... K>				struct	HandyJsonBindMakeSeq<0, K...>	{ typedef HandyJsonBindSeq<K...>	type; };
+
+/*
+	+-------------------+
+	| Declaring members |
+	+-------------------+
+							*/
+#define		HANDYJSON_BIND(Type, ...)										\
+	template <> struct	HandyJsonBinding<Type>								\
+	{																		\
+		typedef Type	Self;												\
+		static const HandyJsonBindField<Type>*	Fields(size_t& count, const size_t*& order)	\
+		{																	\
+			static constexpr HandyJsonBindField<Type>	fields[] = { __VA_ARGS__ };	\
+			static constexpr size_t						n = sizeof(fields) / sizeof(*fields);	\
+			static constexpr HandyJsonBindOrder<n>		sorted = HandyJsonBind::Order(fields, HandyJsonBindMakeSeq<n>::type());	\
+																			\
+			count = n;														\
+			order = sorted.index;											\
+			return (fields);												\
+		}																	\
+	};
+
+#define		HANDYJSON_FIELD(member)				HANDYJSON_FIELD_NAMED(member, #member)
+#define		HANDYJSON_FIELD_NAMED(member, name)	HandyJsonBindField<Self>(name, sizeof(name) - 1, &HandyJsonBind::ReadMember<Self, decltype(Self::member), &Self::member>)
+
+/*
+	+--------------+
+	| Member types |
+	+--------------+
+						*/
+/* Bound structures */
+template <class T, class>
+struct		HandyJsonBindValue
+{
+	static bool			Read(HandyJsonReader& reader, T& value)	{ return (HandyJsonBind::ReadObject(reader, value)); }
+};
+
+template <>
+struct		HandyJsonBindValue<bool>
+{
+	static bool			Read(HandyJsonReader& reader, bool& value)	{ return (reader.ReadBool(value)); }
+};
+
+/* Integers out of the range of the member fail as json_error_type */
+template <class T>
+struct		HandyJsonBindValue<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type>
+{
+	static bool			Read(HandyJsonReader& reader, T& value)
+	{
+		int64_t		i;
+
+		if (!reader.ReadInt64(i))
+			return (false);
+		if (i < (int64_t)std::numeric_limits<T>::min() || i > (int64_t)std::numeric_limits<T>::max())
+			return (reader.Fail());
+		value = (T)i;
+		return (true);
+	}
+};
+
+template <class T>
+struct		HandyJsonBindValue<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value>::type>
+{
+	static bool			Read(HandyJsonReader& reader, T& value)
+	{
+		uint64_t	u;
+
+		if (!reader.ReadUInt64(u))
+			return (false);
+		if (u > (uint64_t)std::numeric_limits<T>::max())
+			return (reader.Fail());
+		value = (T)u;
+		return (true);
+	}
+};
+
+template <class T>
+struct		HandyJsonBindValue<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+	static bool			Read(HandyJsonReader& reader, T& value)
+	{
+		double		d;
+
+		if (!reader.ReadDouble(d))
+			return (false);
+		value = (T)d;
+		return (true);
+	}
+};
+
+template <>
+struct		HandyJsonBindValue<std::string>
+{
+	static bool			Read(HandyJsonReader& reader, std::string& value)
+	{
+		const char*	str;
+		size_t		len;
+
+		if (!reader.ReadString(str, len))
+			return (false);
+		value.assign(str, len);
+		return (true);
+	}
+};
+
+/* The items replace the content, each one is read in place */
+template <class T, class A>
+struct		HandyJsonBindValue<std::vector<T, A> >
+{
+	static bool			Read(HandyJsonReader& reader, std::vector<T, A>& value)
+	{
+		if (!reader.StartArray())
+			return (false);
+		value.clear();
+		while (reader.NextItem())
+		{
+			value.emplace_back();
+			if (!HandyJsonBind::ReadValue(reader, value.back()))
+				return (false);
+		}
+		return (!reader.IsFailed());
+	}
+};
+
+template <class A>
+struct		HandyJsonBindValue<std::vector<bool, A> >
+{
+	static bool			Read(HandyJsonReader& reader, std::vector<bool, A>& value)
+	{
+		bool		b;
+
+		if (!reader.StartArray())
+			return (false);
+		value.clear();
+		while (reader.NextItem())
+		{
+			b = false;
+			if (!HandyJsonBind::ReadValue(reader, b))
+				return (false);
+			value.push_back(b);
+		}
+		return (!reader.IsFailed());
+	}
+};
+
+template <>
+struct		HandyJsonBindValue<HandyJson>
+{
+	static bool			Read(HandyJsonReader& reader, HandyJson& value)	{ return (reader.ReadTree(value)); }
+};
+
+/*
+	+---------+
+	| Reading |
+	+---------+
+				*/
+template <class T>
+bool		HandyJsonBind::Read(const char* json, T& value, HandyJsonError* error)
+{
+	return (HandyJsonBind::ReadWithOpts(json, value, 0, false, error));
+}
+
+template <class T>
+bool		HandyJsonBind::ReadWithOpts(const char* json, T& value, const char** return_parse_end, bool require_null_terminated, HandyJsonError* error)
+{
+	HandyJsonReader		reader(json);
+
+	HandyJsonBind::ReadValue(reader, value);
+	return (reader.Finish(return_parse_end, require_null_terminated, error));
+}
+
+template <class T>
+bool		HandyJsonBind::ReadValue(HandyJsonReader& reader, T& value)
+{
+	return (reader.ReadNull() || HandyJsonBindValue<T>::Read(reader, value));
+}
+
+template <class T>
+bool		HandyJsonBind::ReadObject(HandyJsonReader& reader, T& object)
+{
+	size_t							count;
+	const size_t*					order;			// The members by hash.
+	const HandyJsonBindField<T>*	fields = HandyJsonBinding<T>::Fields(count, order);
+	const HandyJsonBindField<T>*	f;
+	size_t							next = 0;		// The member expected next.
+	const char*						key;
+	size_t							len;
+	uint32_t						hash;
+	size_t							lo, hi, mid;
+
+	if (!reader.StartObject())
+		return (false);
+	while (reader.NextKey(key, len))
+	{
+		f = fields + next;
+		if (next == count || f->len != len || !HandyJsonBind::Equal(f->name, key, len))
+		{
+			hash = HandyJsonBind::HashKey(key, len);
+			for (lo = 0, hi = count; lo < hi;)		// The first member of this hash, or above.
+			{
+				mid = (lo + hi) / 2;
+				if (fields[order[mid]].hash < hash)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			for (f = fields + count; lo < count && fields[order[lo]].hash == hash; ++lo)
+				if (fields[order[lo]].len == len && HandyJsonBind::Equal(fields[order[lo]].name, key, len))
+				{
+					f = fields + order[lo];
+					break;
+				}
+		}
+		if (f == fields + count)
+		{
+			if (!reader.SkipValue())
+				return (false);
+			continue;
+		}
+		next = f - fields + 1;
+		if (!f->read(reader, object))
+			return (false);
+	}
+	return (!reader.IsFailed());
+}
@@ -1,6 +1,9 @@
 #include		<iostream>
 #include		<fstream>
 #include		"HandyJson.h"
+#ifdef HANDYJSON_BINDING
+# include		"HandyJsonBind.h"
+#endif
 
 char*			LoadFile(const char* fname)
 {
@@ -25,18 +28,20 @@ char*			LoadFile(const char* fname)
 
 bool			HandlingHandyJsonItems()
 {
-	char*			json_data;
 	HandyJson		root;
-
-	json_data = LoadFile("HJ_Test.txt");												// File loading,
-	if (!json_data) { std::cout << "Failed to load file." << std::endl; return (false); }	// and check.
+	HandyJsonError	error;
 
 	/*
 		+----------------------------------+
 		| Building the root using the file |
 		+----------------------------------+
 												*/
-	if (!root.Parse(json_data)) { std::cout << "Could not parse the file." << std::endl; return (false); }
+	if (!root.ParseFile("HJ_Test.txt", &error))										// The file is mapped and parsed
+	{																					// in place, no copy is made.
+		std::cout << "Could not parse the file: " << HandyJson::GetErrorText(error.code);
+		std::cout << " (line " << error.line << ", column " << error.column << ")." << std::endl;
+		return (false);
+	}
 
 	/*
 		+------------------------------+
@@ -205,6 +210,357 @@ bool			BuildingHandyJsonTree()
 	return (true);
 }
 
+bool			ReadingLargeNumbers()
+{
+	HandyJson		numbers;
+
+	if (!numbers.Parse("[-9223372036854775808, -10000000000000000000, -11309792265774900000]"))
+	{ std::cout << "Could not parse the numbers." << std::endl; return (false); }
+	std::cout << numbers.GetArrayItem(0)->GetValInt64() << std::endl;				// Exact, as int64_t.
+	std::cout << (numbers.GetArrayItem(1)->GetValDbl() == -1e19 ? "-1e19" : "Wrong") << std::endl;	// Beyond int64_t, as a double.
+	std::cout << (numbers.GetArrayItem(2)->GetValDbl() == -1.13097922657749e19 ? "-1.13097922657749e19" : "Wrong") << std::endl;
+	std::cout << std::endl;
+	return (true);
+}
+
+bool			ParsingInAnArena()
+{
+	char*			json_data;
+	HandyJsonArena	arena;
+
+	json_data = LoadFile("HJ_Test.txt");
+	if (!json_data) { std::cout << "Failed to load file." << std::endl; return (false); }
+
+	/*
+		+------------------------------------------+
+		| Building the whole tree inside the arena |
+		+------------------------------------------+
+														*/
+	HandyJson*		root;
+	root = arena.NewItem();												// Every child, name and string of root
+	if (!root->Parse(json_data))										// will come from the arena blocks.
+	{ std::cout << "Could not parse the file." << std::endl; return (false); }
+	std::cout << root->PrintUnformated() << std::endl;
+	std::cout << std::endl;
+
+	/*
+		+-----------------------------+
+		| Releasing the tree at once  |
+		+-----------------------------+
+										*/
+	arena.Release();													// No delete on root, the arena owns it.
+	std::cout << "Arena released." << std::endl;
+	std::cout << std::endl;
+	delete[] (json_data);
+	return (true);
+}
+
+/*
+	+----------------------------------------------+
+	| An events handler counting numbers of a file |
+	+----------------------------------------------+
+														*/
+class			NumbersCounter : public HandyJsonHandler
+{
+public:
+	int			count;
+	double		sum;
+
+	NumbersCounter() : count(0), sum(0) {}
+	bool		Number(double d) { ++this->count; this->sum += d; return (true); }
+};
+
+bool			ParsingWithEvents()
+{
+	char*			json_data;
+	NumbersCounter	counter;
+
+	json_data = LoadFile("HJ_Test.txt");
+	if (!json_data) { std::cout << "Failed to load file." << std::endl; return (false); }
+
+	if (!HandyJson::ParseSax(json_data, counter))						// No item is built, only the
+	{ std::cout << "Could not parse the file." << std::endl; return (false); }	// events are fired.
+	std::cout << counter.count << " numbers, sum is " << counter.sum << std::endl;
+	std::cout << std::endl;
+	delete[] (json_data);
+	return (true);
+}
+
+bool			ParsingInChunks()
+{
+	std::fstream		file;
+	char				chunk[64];
+	HandyJson			root;
+	HandyJsonBuilder	builder(root);
+	HandyJsonPush		push(builder);
+
+	file.open("HJ_Test.txt", std::ios::in | std::ios::binary);
+	if (!file.is_open()) { std::cout << "Failed to open file." << std::endl; return (false); }
+
+	/*
+		+------------------------------------------+
+		| Feeding the data as it comes, 64 at once |
+		+------------------------------------------+
+														*/
+	while (!push.IsDone() && !push.IsFailed() && file.read(chunk, sizeof(chunk)).gcount())
+		push.Feed(chunk, (size_t)file.gcount());						// Only a token cut between two
+	if (!push.Finish())													// chunks is kept.
+	{ std::cout << "Could not parse the file: " << HandyJson::GetErrorText(push.GetError().code) << std::endl; return (false); }
+	std::cout << root.PrintUnformated() << std::endl;
+	std::cout << std::endl;
+	return (true);
+}
+
+bool			ReadingOnDemand()
+{
+	HandyJsonFile	file;
+	HandyJsonLazy	doc;
+
+	if (!file.Open("HJ_Test.txt")) { std::cout << "Failed to open file." << std::endl; return (false); }
+	if (!doc.Parse(file.GetData()))										// Only the structure is checked
+	{ std::cout << "Could not parse the file." << std::endl; return (false); }	// and indexed.
+
+	/*
+		+---------------------------------------+
+		| Reading two values, skipping the rest |
+		+---------------------------------------+
+													*/
+	HandyJsonLazyItem	root = doc.GetRoot();
+	std::cout << root.GetObjectItem("Int").GetValInt() << std::endl;	// The other values are never
+	std::cout << root.GetObjectItem("String Array").GetArrayItem(4).GetValStr() << std::endl;	// decoded.
+	std::cout << std::endl;
+	return (true);
+}
+
+bool			ReadingFromATape()
+{
+	HandyJsonFile	file;
+	HandyJsonTape	tape;
+	HandyJson		root;
+
+	if (!file.Open("HJ_Test.txt")) { std::cout << "Failed to open file." << std::endl; return (false); }
+	if (!tape.Parse(file.GetData()))									// The whole document in one
+	{ std::cout << "Could not parse the file." << std::endl; return (false); }	// array of entries.
+
+	/*
+		+-------------------------------------+
+		| Walking the tape, then a tree again |
+		+-------------------------------------+
+												*/
+	for (HandyJsonTapeItem c = tape.GetRoot().GetChild(); c.IsValid(); c = c.GetNext())
+		std::cout << c.GetName() << " ";
+	std::cout << std::endl;
+	if (!tape.GetRoot().GetObjectItem("Object").Build(root))			// A mutable copy of one value.
+		return (false);
+	std::cout << root.GetChild()->GetName() << std::endl;
+	std::cout << std::endl;
+	return (true);
+}
+
+bool			QueryingWithPaths()
+{
+	HandyJson		root;
+	HandyJsonPath	path;
+	HandyJson*		matches[8];
+	size_t			count;
+
+	if (!root.ParseFile("HJ_Test.txt")) { std::cout << "Could not parse the file." << std::endl; return (false); }
+
+	/*
+		+-------------------------------+
+		| Compiled once, run many times |
+		+-------------------------------+
+											*/
+	if (path.Compile("/Object/Pair Four/2"))									// A JSON Pointer.
+		std::cout << path.Find(root)->GetValInt() << std::endl;
+	if (path.Compile("$['Array Array'][*][1]"))								// A path, with a wildcard.
+	{
+		count = path.FindAll(root, matches, 8);
+		for (size_t i = 0; i < count && i < 8; ++i)
+			std::cout << matches[i]->GetValStr() << std::endl;
+	}
+	std::cout << std::endl;
+	return (true);
+}
+
+bool			UsingBinaryFormats()
+{
+	HandyJson		root;
+	HandyJson		copy;
+	char*			data;
+	size_t			size;
+
+	if (!root.ParseFile("HJ_Test.txt")) { std::cout << "Could not parse the file." << std::endl; return (false); }
+
+	/*
+		+--------------------------+
+		| To MessagePack, and back |
+		+--------------------------+
+									*/
+	if (!(data = root.PrintMsgPack(size)))												// One buffer, and its size.
+		return (false);
+	std::cout << "MessagePack: " << size << " bytes" << std::endl;
+	if (copy.ParseMsgPack(data, size))													// Read in place.
+		std::cout << copy.GetObjectItem("String Array")->GetArrayItem(4)->GetValStr() << std::endl;
+	delete[] (data);
+	if (!(data = root.PrintCbor(size)))													// Same with CBOR.
+		return (false);
+	std::cout << "CBOR: " << size << " bytes" << std::endl;
+	delete[] (data);
+	std::cout << std::endl;
+	return (true);
+}
+
+bool			StreamingOutput()
+{
+	HandyJson			root;
+	HandyJsonStreamSink	sink(std::cout);
+
+	if (!root.ParseFile("HJ_Test.txt")) { std::cout << "Could not parse the file." << std::endl; return (false); }
+
+	/*
+		+------------------------------+
+		| A tree, with no whole string |
+		+------------------------------+
+											*/
+	root.GetObjectItem("Object")->PrintUnformated(sink);								// Written as it goes.
+	std::cout << std::endl;
+
+	/*
+		+-----------------------+
+		| No tree at all either |
+		+-----------------------+
+									*/
+	HandyJsonWriter		writer(sink, true);
+
+	writer.StartObject();
+	writer.Key("Name");
+	writer.String("Streamed");
+	writer.Key("Values");
+	writer.StartArray();
+	for (int i = 0; i < 4; ++i)
+		writer.Int64(i * i);
+	writer.EndArray();
+	writer.EndObject();
+	if (!writer.Flush())																// Failures stick until Reset().
+		return (false);
+	std::cout << std::endl << std::endl;
+	return (true);
+}
+
+bool			CopyingAndMoving()
+{
+	HandyJson		root;
+
+	if (!root.ParseFile("HJ_Test.txt")) { std::cout << "Could not parse the file." << std::endl; return (false); }
+
+	HandyJson		copy(root);														// Nothing shared, each one frees its own.
+
+	copy.DeleteItemFromObject("Object");
+	std::cout << (root.GetObjectItem("Object") ? "Still in the original" : "Gone") << std::endl;
+	*copy.GetObjectItem("String") = *root.GetObjectItem("Object");					// The item keeps its name.
+	std::cout << copy.GetObjectItem("String")->GetObjectItem("Pair Two")->GetValInt() << std::endl;
+#ifdef HANDYJSON_MOVE
+	HandyJson		moved(std::move(copy));											// Only pointers move.
+
+	std::cout << (copy.GetType() == json_null ? "Moved" : "Copied") << std::endl;
+#endif
+	std::cout << std::endl;
+	return (true);
+}
+
+bool			SharingKeys()
+{
+	HandyJsonKeyPool	keys;													// Declared first, it outlives the trees.
+	HandyJson			first, second;
+	const char*			records = "[{\"customer_id\":1,\"purchase_total\":12.5},{\"customer_id\":2,\"purchase_total\":4}]";
+
+	if (!first.ParseWithOpts(records, 0, true, 0, &keys) || !second.ParseWithOpts(records, 0, true, 0, &keys))
+	{ std::cout << "Could not parse the records." << std::endl; return (false); }
+	std::cout << keys.GetCount() << " names for 8 members" << std::endl;		// Each name is stored once.
+
+	const char*			total = keys.Intern("purchase_total");					// Looked up by pointer.
+
+	std::cout << second.GetArrayItem(1)->GetObjectItem(total)->GetValDbl() << std::endl;
+	std::cout << std::endl;
+	return (true);
+}
+
+#ifdef HANDYJSON_BINDING
+struct			OrderLine
+{
+	std::string			sku;
+	int					quantity;
+};
+
+struct			Order
+{
+	int64_t						id;
+	std::string					customer;
+	bool						paid;
+	double						total;
+	std::vector<OrderLine>		lines;
+	std::vector<std::string>	tags;
+};
+
+HANDYJSON_BIND(OrderLine,
+	HANDYJSON_FIELD(sku),
+	HANDYJSON_FIELD_NAMED(quantity, "qty"))
+
+HANDYJSON_BIND(Order,
+	HANDYJSON_FIELD(id),
+	HANDYJSON_FIELD(customer),
+	HANDYJSON_FIELD(paid),
+	HANDYJSON_FIELD(total),
+	HANDYJSON_FIELD(lines),
+	HANDYJSON_FIELD(tags))
+#endif
+
+bool			ReadingIntoVariables()
+{
+	/*
+		+---------+
+		| By hand |
+		+---------+
+					*/
+	HandyJsonReader		reader("{\"Sizes\":[3,1,4],\"Unused\":{\"Deep\":[true]}}");
+	const char*			key;
+	size_t				len;
+	int64_t				size, sum = 0;
+
+	if (reader.StartObject())
+		while (reader.NextKey(key, len))
+		{
+			if (len == 5 && !memcmp(key, "Sizes", 5) && reader.StartArray())
+				while (reader.NextItem() && reader.ReadInt64(size))
+					sum += size;
+			else
+				reader.SkipValue();												// Checked, but not read.
+		}
+	if (!reader.Finish()) { std::cout << "Could not read the sizes." << std::endl; return (false); }
+	std::cout << "Sum of the sizes: " << sum << std::endl;
+
+#ifdef HANDYJSON_BINDING
+	/*
+		+------------------+
+		| Into a structure |
+		+------------------+
+								*/
+	Order				order;
+	HandyJsonError		error;
+	const char*			json = "{\"id\":42,\"customer\":\"Relax\",\"paid\":true,\"total\":31.5,\"coupon\":null,"
+		"\"lines\":[{\"sku\":\"A-1\",\"qty\":2},{\"qty\":1,\"sku\":\"B-7\"}],\"tags\":[\"gift\"]}";
+
+	if (!HandyJsonBind::Read(json, order, &error)) { std::cout << HandyJson::GetErrorText(error.code) << std::endl; return (false); }
+	std::cout << order.id << " " << order.customer << " " << order.lines.size() << " lines, "
+		<< order.lines[1].sku << " x" << order.lines[1].quantity << std::endl;		// Unknown names are skipped.
+	if (!HandyJsonBind::Read("{\"id\":\"43\"}", order, &error))						// No conversion between types.
+		std::cout << HandyJson::GetErrorText(error.code) << " at offset " << error.offset << std::endl;
+#endif
+	std::cout << std::endl;
+	return (true);
+}
+
 // Tester les detach
 // Tester le replace
 int				main()
@@ -212,6 +568,18 @@ int				main()
 	
 	HandlingHandyJsonItems();
 	BuildingHandyJsonTree();
+	ReadingLargeNumbers();
+	ParsingInAnArena();
+	ParsingWithEvents();
+	ParsingInChunks();
+	ReadingOnDemand();
+	ReadingFromATape();
+	QueryingWithPaths();
+	UsingBinaryFormats();
+	StreamingOutput();
+	CopyingAndMoving();
+	SharingKeys();
+	ReadingIntoVariables();
 	system("PAUSE");
 	return (0);
 }